@@ -0,0 +1,36 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+
+/* Checks of the library against the long double path, closed forms and the per-cube
+ * classification, and of the other traversals against integrate (on the example of
+ * example.h). Each file has one function, called from main, which reports failed
+ * conditions with CHECK. The program fails if any of them does
+ */
+
+namespace Checks {
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    inline void check(bool condition, const char* what, const char* file, int line) {
+        if (!condition) {
+            std::cerr << file << ":" << line << ": check failed: " << what << std::endl;
+            failures()++;
+        }
+    }
+
+    void check_precision();
+    void check_classification();
+    void check_multivariate_normal();
+    void check_storage();
+    void check_parallel();
+    void check_depth_first();
+    void check_resumable();
+}
+
+#define CHECK(condition) Checks::check((condition), #condition, __FILE__, __LINE__)
+
+#endif // CHECK_H
@@ -0,0 +1,18 @@
+TEMPLATE = app
+TARGET = checks
+CONFIG += console c++1z thread testcase -Wall
+CONFIG -= app_bundle qt
+
+DEPENDPATH += . ../lib
+INCLUDEPATH += ../lib
+
+HEADERS += check.h \
+    example.h
+SOURCES += main.cpp \
+    precision.cpp \
+    classification.cpp \
+    multivariate_normal.cpp \
+    storage.cpp \
+    parallel.cpp \
+    depth_first.cpp \
+    resumable.cpp
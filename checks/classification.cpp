@@ -0,0 +1,85 @@
+#include <array>
+#include <cstddef>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "hypercube.h"
+#include "polygon.h"
+
+/* The batched classification of the parts of a cube (basic_polygon::contains_parts)
+ * against contains for each part, on random polygons whose equations pass through
+ * corners and centers of the parts or have tiny or zero coefficients, so that many
+ * outcomes are decided by the rounding bound of the batch
+ */
+
+using namespace Integration;
+
+namespace {
+    template <unsigned int N, typename T>
+    void check_parts(std::mt19937& generator, int cases) {
+        std::uniform_real_distribution<double> uniform(-1, 1);
+        std::uniform_int_distribution<int> pick(0, 5), equations(1, 4);
+        constexpr std::size_t parts = std::size_t(1) << N;
+
+        for (int n = 0; n < cases; n++) {
+            HyperCube<N, T> cube;
+            for (auto& [a, b] : cube.intervals) {
+                a = T(uniform(generator));
+                b = a + T(n % 3 ? 1 : 1e-6) * T(1 + uniform(generator));
+            }
+
+            std::vector<linear_equation> system;
+            for (int k = equations(generator); k > 0; k--) {
+                std::vector<long double> e(N);
+                for (auto& x : e) {
+                    const int kind = pick(generator);
+                    x = kind == 0 ? 0 : kind == 1 ? 1e-9L * uniform(generator) : uniform(generator);
+                }
+
+                // Through a corner or the center of a random part, or anywhere
+                const auto part = cube.part(std::size_t(generator()) % parts);
+                long double d = 0;
+                for (std::size_t i = 0; i < N; i++) {
+                    const auto& [a, b] = part.intervals[i];
+                    const int kind = pick(generator);
+                    d -= e[i] * (kind < 2 ? a : kind < 4 ? b : (a + b) / 2);
+                }
+                if (pick(generator) == 0)
+                    d += uniform(generator);
+                system.push_back({ e, d });
+            }
+
+            const polygon poly(system);
+            auto active = poly.boundaries();
+            if (poly.contains(cube, active) != INDEFINITE)
+                continue;
+
+            std::array<REGION_STATE, parts> states;
+            std::array<polygon::active_type, parts> actives;
+            poly.contains_parts(cube, active, states, actives);
+            for (std::size_t i = 0; i < parts; i++) {
+                auto expected = active;
+                const REGION_STATE state = poly.contains(cube.part(i), expected);
+                CHECK(states[i] == state);
+                if (state == INDEFINITE)
+                    CHECK(*actives[i] == *expected);
+            }
+        }
+    }
+
+    template <typename T>
+    void check_dimensions(std::mt19937& generator) {
+        check_parts<1, T>(generator, 8000);
+        check_parts<2, T>(generator, 8000);
+        check_parts<3, T>(generator, 8000);
+        check_parts<4, T>(generator, 8000);
+        check_parts<5, T>(generator, 8000);
+    }
+}
+
+void Checks::check_classification() {
+    std::mt19937 generator(1);
+    check_dimensions<float>(generator);
+    check_dimensions<double>(generator);
+    check_dimensions<long double>(generator);
+}
@@ -0,0 +1,25 @@
+#include <cmath>
+#include "check.h"
+#include "example.h"
+#include "normal_distribution.h"
+
+/* integrate with DEPTH_FIRST against the breadth-first one on the example of README.md:
+ * the same cubes are visited in another order, so the sum, the error and the number of
+ * cubes are the same
+ */
+
+using namespace Integration;
+
+void Checks::check_depth_first() {
+    const auto poly = example_polygon();
+    const auto cube = example_cube();
+
+    for (unsigned max_splits = 2; max_splits <= 8; max_splits++) {
+        const auto expected = poly.integrate(cube, pdf_integral, pdf_minmax, max_splits, true);
+        const auto result = poly.integrate(cube, pdf_integral, pdf_minmax, max_splits, true, DEPTH_FIRST);
+        CHECK(result.sum == expected.sum && result.error == expected.error);
+        CHECK(result.cubes.size() == expected.cubes.size());
+        if (max_splits == 8)
+            CHECK(std::fabs(result.sum - 0.93693188395L) < 1e-11 && result.cubes.size() == 2320);
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef EXAMPLE_H
+#define EXAMPLE_H
+
+#include "hypercube.h"
+#include "polygon.h"
+
+namespace Checks {
+    // The region and the bounding box of the example in README.md
+    inline Integration::polygon example_polygon() {
+        return Integration::polygon({ {{1, 1}, -4}, {{-3, 1}, -5}, {{1, -2}, -6} });
+    }
+
+    inline Integration::HyperCube<2> example_cube() {
+        return Integration::HyperCube<2>(-5, 5);
+    }
+}
+
+#endif // EXAMPLE_H
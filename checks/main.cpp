@@ -0,0 +1,19 @@
+#include <iostream>
+#include "check.h"
+
+int main() {
+    Checks::check_precision();
+    Checks::check_classification();
+    Checks::check_multivariate_normal();
+    Checks::check_storage();
+    Checks::check_parallel();
+    Checks::check_depth_first();
+    Checks::check_resumable();
+
+    if (Checks::failures() > 0) {
+        std::cerr << Checks::failures() << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <cmath>
+#include <stdexcept>
+#include "check.h"
+#include "const.h"
+#include "ellipsoid.h"
+#include "hypercube.h"
+#include "multivariate_normal.h"
+#include "polygon.h"
+
+/* multivariate_normal::probability against closed forms: the quadrant below the mean of
+ * a bivariate normal with correlation rho has probability 1/4 + asin(rho) / (2 pi), and
+ * the unit disk of the standard normal 1 - exp(-1/2). A disk of a correlated normal has the
+ * probability of the same disk of the normal with the covariance rotated to a diagonal one
+ */
+
+using namespace Integration;
+
+void Checks::check_multivariate_normal() {
+    for (double rho : {0.0, 0.5, -0.8, 0.95}) {
+        multivariate_normal distribution({1, -2}, {{4, 6 * rho}, {6 * rho, 9}});
+        polygon quadrant({ {{1, 0}, -1}, {{0, 1}, 2} });   // x <= 1, y <= -2
+        const auto result = distribution.probability<HyperCube<2>>(quadrant, 9);
+        const long double exact = 0.25L + std::asin(rho) / (2 * pi());
+        CHECK(result.sum <= exact && exact <= result.sum + result.error);
+        CHECK(result.error < 1e-3);
+    }
+
+    multivariate_normal standard({0, 0}, {{1, 0}, {0, 1}});
+    const auto disk = standard.probability<HyperCube<2>>(ellipsoid({1, 1}, {0, 0}, 1), 9);
+    const long double exact = 1 - std::exp(-0.5L);
+    CHECK(disk.sum <= exact && exact <= disk.sum + disk.error);
+
+    // Not axis-aligned in the standard coordinates, so it is integrated as a quadric. The disk
+    // is the same after rotating the covariance to its eigenvectors, with variances 1.5 and 0.5
+    multivariate_normal correlated({0, 0}, {{1, 0.5}, {0.5, 1}}), rotated({0, 0}, {{1.5, 0}, {0, 0.5}});
+    const auto skewed = correlated.probability<HyperCube<2>>(ellipsoid({1, 1}, {0, 0}, 1), 9);
+    const auto aligned = rotated.probability<HyperCube<2>>(ellipsoid({1, 1}, {0, 0}, 1), 9);
+    CHECK(skewed.sum <= aligned.sum + aligned.error && aligned.sum <= skewed.sum + skewed.error);
+    CHECK(skewed.error < 2e-3);
+
+    bool thrown = false;
+    try {
+        multivariate_normal({0, 0}, {{1, 2}, {2, 1}});
+    } catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
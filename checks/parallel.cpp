@@ -0,0 +1,24 @@
+#include "check.h"
+#include "example.h"
+#include "normal_distribution.h"
+
+/* integrate_parallel against integrate on the example of README.md: the sum, the error and
+ * the number of cubes are the same on any number of threads, with max_splits above and
+ * below the depth the work is split into tasks at
+ */
+
+using namespace Integration;
+
+void Checks::check_parallel() {
+    const auto poly = example_polygon();
+    const auto cube = example_cube();
+
+    for (unsigned max_splits : {2, 5, 8}) {
+        const auto expected = poly.integrate(cube, pdf_integral, pdf_minmax, max_splits, true);
+        for (unsigned threads : {1, 2, 3}) {
+            const auto result = poly.integrate_parallel(cube, pdf_integral, pdf_minmax, max_splits, threads, true);
+            CHECK(result.sum == expected.sum && result.error == expected.error);
+            CHECK(result.cubes.size() == expected.cubes.size());
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#include <cmath>
+#include <limits>
+#include "check.h"
+#include "ellipsoid.h"
+#include "hypercube.h"
+#include "normal_distribution.h"
+#include "polygon.h"
+#include "precision.h"
+
+/* double_precision and fast_precision against extended_precision, on the polygon
+ * and the ellipsoid of README.md
+ */
+
+using namespace Integration;
+
+namespace {
+    // Both results bound the same integral, so their [sum, sum + error] must overlap,
+    // and with the same cubes the sums may only differ by rounding
+    template <typename Low, typename High>
+    void check_agree(const Low& low, const High& high, long double tolerance) {
+        const long double low_sum = low.sum, low_error = low.error;
+        const long double high_sum = high.sum, high_error = high.error;
+        CHECK(low_sum <= high_sum + high_error && high_sum <= low_sum + low_error);
+        CHECK(std::fabs(low_sum - high_sum) <= tolerance * std::fabs(high_sum));
+        CHECK(std::fabs(low_error - high_error) <= tolerance * high_error);
+        CHECK(low.cubes.size() == high.cubes.size());
+    }
+
+    template <typename Precision>
+    void check_regions() {
+        using real_type = typename Precision::real_type;
+        const long double tolerance = 1e3 * std::numeric_limits<real_type>::epsilon();
+
+        HyperCube<2> cube(-5, 5);
+        polygon reference({ {{1, 1}, -4}, {{-3, 1}, -5}, {{1, -2}, -6} });
+        basic_polygon<Precision> poly({ {{1, 1}, -4}, {{-3, 1}, -5}, {{1, -2}, -6} });
+        for (unsigned int max_splits : {4u, 7u, 10u})
+            check_agree(poly.integrate(cube, basic_pdf_integral<real_type>, basic_pdf_minmax<real_type>,
+                                       max_splits, true),
+                        reference.integrate(cube, pdf_integral, pdf_minmax, max_splits, true), tolerance);
+
+        HyperCube<3> cube3(-3, 3);
+        ellipsoid reference_ellipsoid({1, 2, 3}, {0.1, 0.2, 0.3}, 4);
+        basic_ellipsoid<Precision> el({1, 2, 3}, {0.1, 0.2, 0.3}, 4);
+        for (unsigned int max_splits : {3u, 6u})
+            check_agree(el.integrate(cube3, basic_pdf_integral<real_type>, basic_pdf_minmax<real_type>,
+                                     max_splits, true),
+                        reference_ellipsoid.integrate(cube3, pdf_integral, pdf_minmax, max_splits, true), tolerance);
+    }
+
+    // A million terms of different magnitudes, summed in double with compensation,
+    // against the plain long double sum
+    void check_compensated() {
+        compensated<double> sum;
+        long double reference = 0;
+        for (int k = 1; k <= 1000000; k++) {
+            const double term = (k % 2 ? 1e8 : 1e-8) / k;
+            sum += term;
+            reference += term;
+        }
+        CHECK(std::fabs(sum.value() - reference) <= 2 * std::numeric_limits<double>::epsilon() * reference);
+    }
+}
+
+void Checks::check_precision() {
+    check_regions<double_precision>();
+    check_regions<fast_precision>();
+    check_compensated();
+}
@@ -0,0 +1,31 @@
+#include "check.h"
+#include "example.h"
+#include "normal_distribution.h"
+
+/* resumable_integration against integrate on the example of README.md: after every refine
+ * the totals and the number of cubes are the ones integrate gives with max_splits = depth(),
+ * and refine_until stops at the first depth with the error at most the target
+ */
+
+using namespace Integration;
+
+void Checks::check_resumable() {
+    const auto poly = example_polygon();
+    const auto cube = example_cube();
+
+    auto resumable = poly.integrate_resumable(cube, pdf_integral, pdf_minmax, 2, true);
+    for (unsigned max_splits = 2; max_splits <= 8; max_splits++, resumable.refine()) {
+        const auto expected = poly.integrate(cube, pdf_integral, pdf_minmax, max_splits, true);
+        const auto result = resumable.result();
+        CHECK(resumable.depth() == max_splits);
+        CHECK(result.sum == expected.sum && result.error == expected.error);
+        CHECK(result.cubes.size() == expected.cubes.size());
+    }
+
+    // The error is 0.0011 at depth 7 and 0.00027 at depth 8
+    auto until = poly.integrate_resumable(cube, pdf_integral, pdf_minmax, 2);
+    until.refine_until(1e-3, 20);
+    const auto expected = poly.integrate(cube, pdf_integral, pdf_minmax, 8);
+    CHECK(until.depth() == 8);
+    CHECK(until.sum() == expected.sum && until.error() == expected.error);
+}
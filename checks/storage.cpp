@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <string>
+#include "check.h"
+#include "example.h"
+#include "normal_distribution.h"
+#include "storage.h"
+
+/* A decomposition written by binary_file_sink and mapped back by mapped_decomposition has
+ * the totals, the cubes and the states of the integration that wrote it. The totals of
+ * long double are read in place, which a build with -fsanitize=alignment checks
+ */
+
+using namespace Integration;
+
+void Checks::check_storage() {
+    const auto poly = example_polygon();
+    const auto cube = example_cube();
+    const std::string path = "checks_storage.bin";
+    const unsigned max_splits = 6;
+
+    const auto expected = poly.integrate(cube, pdf_integral, pdf_minmax, max_splits, true);
+    {
+        binary_file_sink<HyperCube<2>> file(path, cube);
+        const auto written = poly.integrate(cube, pdf_integral, pdf_minmax, max_splits, file);
+        file.close();
+        CHECK(written.sum == expected.sum && written.error == expected.error);
+    }
+
+    {
+        mapped_decomposition<HyperCube<2>> stored(path);
+        CHECK(stored.sum() == expected.sum && stored.error() == expected.error);
+        CHECK(stored.origin().intervals == cube.intervals);
+        CHECK(stored.records() == expected.cubes.size());
+
+        const auto result = stored.result();
+        CHECK(result.sum == expected.sum && result.error == expected.error);
+        CHECK(result.cubes.size() == expected.cubes.size());
+        bool same = result.cubes.size() == expected.cubes.size();
+        for (std::size_t i = 0; same && i < result.cubes.size(); i++)
+            same = result.cubes[i].first->intervals == expected.cubes[i].first->intervals &&
+                   result.cubes[i].second == expected.cubes[i].second;
+        CHECK(same);
+
+        const auto again = stored.integrate(pdf_integral, pdf_minmax);
+        CHECK(again.sum == expected.sum && again.error == expected.error);
+    }
+    std::remove(path.c_str());
+}
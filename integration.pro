@@ -1,2 +1,2 @@
 TEMPLATE = subdirs
-SUBDIRS += lib test
+SUBDIRS += lib test checks
@@ -5,8 +5,8 @@
 #include "integrationresult.h"
 
 namespace Integration {
-    template <typename T>
-    void view_result(const Result<T>& result) {
+    template <typename T, typename Real>
+    void view_result(const Result<T, Real>& result) {
         int argc = 1;
         char *argv[] = { const_cast<char *>("Result")};
         QApplication app(argc, argv);
@@ -0,0 +1,168 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "const.h"
+#include "integrationresult.h"
+#include "traversal.h"
+
+/* Error-driven refinement: instead of splitting every boundary cube down to
+ * the same depth, always split the boundary cube with the largest contribution
+ * to the error, until the requested precision or the cube budget is reached.
+ * Every boundary cube waiting to be split already contributes its bounds to the
+ * result, so the refinement can be stopped at any time, e.g. at a deadline, and
+ * [sum, sum + error] still contains the integral
+ */
+
+namespace Integration {
+    // Stopping criteria of the adaptive integration. Refinement stops as soon as
+    // error <= absolute, or error <= relative * |sum|, or splitting another cube
+    // would exceed max_cubes classified cubes, or the deadline has passed, or *cancelled
+    // is set (from any thread). Cubes at depth max_splits are never split.
+    // progress, if set, is called with the bounds [sum, sum + error] of the integral and
+    // the number of classified cubes every progress_interval cubes, and once at the end
+    struct tolerance {
+        long double absolute = 0, relative = 0;
+        std::size_t max_cubes = 1 << 20;
+        unsigned int max_splits = 32;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        const std::atomic<bool>* cancelled = nullptr;
+        std::function<void(long double low, long double high, std::size_t cubes)> progress;
+        std::size_t progress_interval = 1 << 12;
+    };
+
+    // The region must provide
+    //  - active_type: the constraints a cube inherits from its parent;
+    //  - boundaries(): the constraints of the root cube;
+    //  - contains(hc, active): the state of the cube, dropping constraints from active
+    //    that are satisfied everywhere in the cube;
+    //  - measure_estimates(hc, active): bounds of the measure of the region within the cube;
+    //  - optionally, contains_parts(hc, active, states, actives): contains for all 2^N parts
+    //    of hc at once (see split_classified)
+    template <typename Region, typename Cube, typename Integral, typename Function>
+    Result<Cube, typename Region::real_type> integrate_adaptive(const Region& region, const Cube& cube,
+                                                                Integral Int, Function f, const tolerance& tol,
+                                                                bool return_cubes = false) {
+        using active_type = typename Region::active_type;
+        using real_type = typename Region::real_type;
+
+        struct cube_info {
+            real_type sum, error;
+            Cube* hc;
+            unsigned int depth;
+            active_type active;
+
+            bool operator<(const cube_info& other) const {
+                return error < other.error;
+            }
+        };
+
+        auto result = Result<Cube, real_type>{};
+        result.origin = std::make_shared<Cube>(cube);
+        result.arena = std::make_shared<cube_arena<Cube>>();
+        auto& arena = *result.arena;
+
+        // Boundary cubes that may still be split, a heap with the largest error on top
+        std::vector<cube_info> boundary;
+        // Sum and error of the cubes in the heap, only used to decide when to stop
+        compensated<real_type> pending_sum, pending_error;
+        std::size_t classified = 0;
+
+        auto visit = [&](Cube* hc, unsigned int depth, REGION_STATE state, active_type active) {
+            classified++;
+
+            switch (state) {
+                case INDEFINITE: {
+                    const auto& [mlow, mhigh] = region.measure_estimates(*hc, active);
+                    const auto& [flow, fhigh] = f(*hc);
+                    const auto& [sum, error] = boundary_estimates<real_type>(mlow, mhigh, flow, fhigh);
+
+                    if (depth < tol.max_splits) {
+                        pending_sum += sum;
+                        pending_error += error;
+                        boundary.push_back({ sum, error, hc, depth, std::move(active) });
+                        std::push_heap(boundary.begin(), boundary.end());
+                        return;
+                    }
+
+                    result.sum += sum;
+                    result.error += error;
+                    break;
+                }
+
+                case CONTAINED:
+                    add_integral(result, Int(*hc));
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (return_cubes)
+                result.cubes.push_back({ hc, state });
+            else
+                arena.release(hc);
+        };
+
+        auto root = region.boundaries();
+        REGION_STATE state = region.contains(cube, root);
+        visit(arena.make(cube), 0, state, std::move(root));
+
+        const bool timed = tol.deadline != std::chrono::steady_clock::time_point::max();
+        std::size_t next_progress = tol.progress_interval;
+
+        while (!boundary.empty()) {
+            const real_type error = result.error.value() + pending_error.value(),
+                            sum = result.sum.value() + pending_sum.value();
+            if (error <= tol.absolute || error <= tol.relative * std::fabs(sum))
+                break;
+            if (classified + (std::size_t(1) << Cube::dimensions) > tol.max_cubes)
+                break;
+            if (tol.cancelled && tol.cancelled->load(std::memory_order_relaxed))
+                break;
+            if (timed && std::chrono::steady_clock::now() >= tol.deadline)
+                break;
+            if (tol.progress && classified >= next_progress) {
+                tol.progress(sum, sum + error, classified);
+                next_progress = classified + tol.progress_interval;
+            }
+
+            std::pop_heap(boundary.begin(), boundary.end());
+            auto worst = std::move(boundary.back());
+            boundary.pop_back();
+            pending_sum -= worst.sum;
+            pending_error -= worst.error;
+
+            split_classified(region, arena, *worst.hc, worst.active,
+                             [&](Cube* part, REGION_STATE state, active_type active) {
+                                 visit(part, worst.depth + 1, state, std::move(active));
+                             });
+            arena.release(worst.hc);
+        }
+
+        // Cubes left in the heap are the rest of the boundary. Their contributions
+        // are added anew, so that the rounding errors of pending_* do not leak in.
+        // They are taken in the order of the heap, not sorted, so that stopping at
+        // a deadline does not cost another n log n
+        for (const auto& info : boundary) {
+            result.sum += info.sum;
+            result.error += info.error;
+            if (return_cubes)
+                result.cubes.push_back({ info.hc, INDEFINITE });
+        }
+
+        if (tol.progress)
+            tol.progress(result.sum.value(), result.sum.value() + result.error.value(), classified);
+        return result;
+    }
+}
+
+#endif // ADAPTIVE_H
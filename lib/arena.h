@@ -0,0 +1,62 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Integration {
+    // Pool of cubes allocated in blocks. Released cubes are put on a free list and
+    // handed out again, so a long integration reuses the same few blocks instead of
+    // allocating every cube separately. Pointers stay valid until the arena is destroyed
+    template <typename Cube>
+    class cube_arena {
+    public:
+        explicit cube_arena(std::size_t block_size = 1024) : block_size(block_size) { }
+
+        cube_arena(const cube_arena&) = delete;
+        cube_arena& operator=(const cube_arena&) = delete;
+
+        Cube* make(const Cube& cube) {
+            Cube* hc;
+            if (!free.empty()) {
+                hc = free.back();
+                free.pop_back();
+            } else {
+                if (blocks.empty() || used == block_size) {
+                    blocks.emplace_back(new Cube[block_size]);
+                    used = 0;
+                }
+                hc = &blocks.back()[used++];
+            }
+
+            *hc = cube;
+            return hc;
+        }
+
+        // The cube may be handed out again by make
+        void release(Cube* hc) {
+            free.push_back(hc);
+        }
+
+        // Take over the blocks of another arena, keeping its cubes alive
+        void merge(cube_arena&& other) {
+            // Only the last block is being filled, so it has to stay last
+            if (blocks.empty())
+                used = other.used;
+            blocks.insert(blocks.begin(), std::make_move_iterator(other.blocks.begin()),
+                                          std::make_move_iterator(other.blocks.end()));
+            free.insert(free.end(), other.free.begin(), other.free.end());
+            other.blocks.clear();
+            other.free.clear();
+        }
+
+    private:
+        std::size_t block_size, used = 0;
+        std::vector<std::unique_ptr<Cube[]>> blocks;
+        std::vector<Cube*> free;
+    };
+}
+
+#endif // ARENA_H
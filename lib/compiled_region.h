@@ -0,0 +1,146 @@
+#ifndef COMPILED_REGION_H
+#define COMPILED_REGION_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <queue>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "const.h"
+#include "integrationresult.h"
+#include "traversal.h"
+
+/* Decomposition of a region into cubes that is built once and integrated many times.
+ * The tree is split and classified as in region.integrate(cube, Int, f, max_splits),
+ * but only the cubes it ends with are kept: the contained cubes and the boundary cubes
+ * at depth max_splits with the bounds of the measure of the region within them, and
+ * the rejected cubes if they are to be returned
+ */
+
+namespace Integration {
+    template <typename Cube, typename Real = long double>
+    class compiled_region {
+    public:
+        // A cube the tree ends with. mlow and mhigh are only set for boundary cubes
+        struct compiled_cube {
+            const Cube* hc;
+            REGION_STATE state;
+            Real mlow, mhigh;
+        };
+
+        // Rejected cubes are only kept if keep_rejected is true, for the results of integrate
+        // with return_cubes
+        template <typename Region>
+        compiled_region(const Region& region, const Cube& cube, unsigned max_splits, bool keep_rejected = true)
+                : origin(std::make_shared<Cube>(cube)), arena(std::make_shared<cube_arena<Cube>>()) {
+            auto root = region.boundaries();
+            REGION_STATE root_state = region.contains(cube, root);
+            std::queue<queued_cube<Region, Cube>> queue {{ { arena->make(cube), 0, std::move(root), root_state } }};
+
+            for ( ; !queue.empty(); queue.pop()) {
+                auto& [hc, depth, active, state] = queue.front();
+
+                switch (state) {
+                    case INDEFINITE:
+                        if (depth >= max_splits) {
+                            const auto& [mlow, mhigh] = region.measure_estimates(*hc, active);
+                            cubes.push_back({ hc, state, mlow, mhigh });
+                        } else {
+                            split_classified(region, *arena, *hc, active,
+                                             [&, depth = depth](Cube* part, REGION_STATE state, auto active) {
+                                                 queue.push({ part, depth + 1, std::move(active), state });
+                                             });
+                            arena->release(hc);
+                        }
+                        break;
+
+                    case CONTAINED:
+                        cubes.push_back({ hc, state, 0, 0 });
+                        break;
+
+                    default:
+                        if (keep_rejected)
+                            rejected.push_back({ cubes.size(), hc });
+                        else
+                            arena->release(hc);
+                        break;
+                }
+            }
+        }
+
+        // Same as region.integrate(cube, Int, f, max_splits, return_cubes) for the region, cube
+        // and max_splits this was built with, without splitting or classifying anything.
+        // The returned cubes belong to this object and are shared with every other result,
+        // and only include the rejected ones if it was built with keep_rejected
+        template <typename Integral, typename Function>
+        Result<Cube, Real> integrate(Integral Int, Function f, bool return_cubes = false) const {
+            auto result = Result<Cube, Real>{};
+            result.origin = origin;
+            result.arena = arena;
+
+            for (const auto& [hc, state, mlow, mhigh] : cubes) {
+                if (state == CONTAINED) {
+                    add_integral(result, Int(*hc));
+                } else {
+                    const auto& [flow, fhigh] = f(*hc);
+                    const auto& [low, error] = boundary_estimates<Real>(mlow, mhigh, flow, fhigh);
+                    result.sum += low;
+                    result.error += error;
+                }
+            }
+
+            if (return_cubes)
+                result.cubes = all_cubes();
+
+            return result;
+        }
+
+        // Same as integrate for every (Int, f) pair of integrands, a std::tuple or std::array
+        // of them, in a single pass (see integrate_many in traversal.h)
+        template <typename Integrands>
+        auto integrate_many(const Integrands& integrands, bool return_cubes = false) const {
+            std::array<Result<Cube, Real>, std::tuple_size_v<Integrands>> results{};
+            for (auto& result : results) {
+                result.origin = origin;
+                result.arena = arena;
+            }
+
+            for (const auto& [hc, state, mlow, mhigh] : cubes)
+                add_contributions(results, integrands, *hc, state, mlow, mhigh);
+
+            if (return_cubes)
+                for (auto& result : results)
+                    result.cubes = all_cubes();
+
+            return results;
+        }
+
+        // Contained and boundary cubes, in the order in which integrate adds them up
+        const std::vector<compiled_cube>& contents() const { return cubes; }
+
+    private:
+        // All cubes in the order of the traversal, as region.integrate returns them
+        std::vector<std::pair<const Cube*, REGION_STATE>> all_cubes() const {
+            std::vector<std::pair<const Cube*, REGION_STATE>> rv;
+            rv.reserve(cubes.size() + rejected.size());
+            auto next = rejected.begin();
+            for (std::size_t i = 0; i <= cubes.size(); i++) {
+                for ( ; next != rejected.end() && next->first == i; ++next)
+                    rv.push_back({ next->second, REJECTED });
+                if (i < cubes.size())
+                    rv.push_back({ cubes[i].hc, cubes[i].state });
+            }
+            return rv;
+        }
+
+        std::vector<compiled_cube> cubes;
+        // Rejected cubes with the number of cubes before them
+        std::vector<std::pair<std::size_t, const Cube*>> rejected;
+        std::shared_ptr<Cube> origin;
+        std::shared_ptr<cube_arena<Cube>> arena;
+    };
+}
+
+#endif // COMPILED_REGION_H
@@ -1,12 +1,28 @@
 #ifndef CONST_H
 #define CONST_H
 
+#include <cstddef>
 #include <cstdint>
 #include <cmath>
 
+// Attribute of the batched kernels. It can be defined as e.g.
+// __attribute__((target_clones("avx512f", "avx2", "default"))) to compile them for several
+// instruction sets and pick one at runtime. That is off by default: on batches of up to 2^6
+// parts the indirect call costs more than the wider vectors gain, and -march builds get them inline
+#ifndef INTEGRATION_TARGET_CLONES
+#  define INTEGRATION_TARGET_CLONES
+#endif
+
 namespace Integration {
     constexpr double pi() { return std::atan(1) * 4; }
+    constexpr std::size_t ipow(std::size_t base, unsigned int exponent) {
+        std::size_t rv = 1;
+        while (exponent-- > 0)
+            rv *= base;
+        return rv;
+    }
     enum REGION_STATE : int8_t { REJECTED, CONTAINED, INDEFINITE };
+    enum TRAVERSAL : int8_t { BREADTH_FIRST, DEPTH_FIRST };
 }
 
 #endif // CONST_H
@@ -0,0 +1,34 @@
+#ifndef DIMENSIONS_H
+#define DIMENSIONS_H
+
+#include <array>
+#include <vector>
+
+/* Regions and functions either have the number of variables fixed at compile time,
+ * in which case their coefficients are kept in std::arrays and can only be used with
+ * cubes of that dimension, or set at runtime (dynamic_dimensions) with std::vectors
+ */
+
+namespace Integration {
+    constexpr unsigned int dynamic_dimensions = 0;
+
+    template <typename T, unsigned int N>
+    struct coefficients {
+        using type = std::array<T, N>;
+    };
+
+    template <typename T>
+    struct coefficients<T, dynamic_dimensions> {
+        using type = std::vector<T>;
+    };
+
+    // N coefficients of type T, or any number of them if N is dynamic_dimensions
+    template <typename T, unsigned int N>
+    using coefficients_t = typename coefficients<T, N>::type;
+
+    // Whether something of N variables can be used with Cube
+    template <unsigned int N, typename Cube>
+    constexpr bool dimensions_match = N == dynamic_dimensions || N == Cube::dimensions;
+}
+
+#endif // DIMENSIONS_H
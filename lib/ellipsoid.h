@@ -2,42 +2,60 @@
 #define ELLIPSOID_H
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstddef>
-#include <memory>
 #include <vector>
-#include <queue>
 #include <utility>
 #include <tuple>
+#include <type_traits>
 #include "const.h"
-#include "integrationresult.h"
+#include "dimensions.h"
 #include "linear.h"
+#include "precision.h"
+#include "region.h"
 
 /* Utilities for integrating over regions restricted by an equation
  * of the form  a1(x1 - c1)^2 + a2(x2 - c2)^2  + ... + aN(xN - cN)^2 - d <= 0
 */
 
 namespace Integration {
-    class ellipsoid
+    template <typename Precision, unsigned int N = dynamic_dimensions>
+    class basic_ellipsoid : public integrable_region<basic_ellipsoid<Precision, N>>
     {
+    public:
+        using real_type = typename Precision::real_type;
+        // Coefficients or center, see dimensions.h
+        using vector_type = coefficients_t<real_type, N>;
+
     private:
-        std::vector<long double> coeffs, center;
-        long double d;
+        vector_type coeffs, center;
+        real_type d;
         // Sum of coefficients
-        long double sum;
+        real_type sum;
 
     public:
-        ellipsoid(std::vector<long double> _coeffs, std::vector<long double> _center, long double _d)
+        basic_ellipsoid(vector_type _coeffs, vector_type _center, real_type _d)
                   : coeffs(std::move(_coeffs)), center(std::move(_center)), d(_d) {
             sum = 0;
             for (const auto& x : coeffs)
                 sum += x;
         }
 
+        const vector_type& coefficients() const { return coeffs; }
+        const vector_type& center_point() const { return center; }
+        real_type bound() const { return d; }
+
+        // The region is given by a single equation, so cubes carry no constraints
+        using active_type = std::tuple<>;
+
+        active_type boundaries() const { return {}; }
+
         template <typename Cube>
-        std::pair<long double, long double> measure_estimates(const Cube& hc) const {
-            long double gc = -d, tau = 0, a, b, medium;
-            std::vector<long double> e(hc.dimensions);
+        std::pair<real_type, real_type> measure_estimates(const Cube& hc) const {
+            static_assert(dimensions_match<N, Cube>, "The ellipsoid has a different number of variables");
+            real_type gc = -d, tau = 0, a, b, medium;
+            std::array<real_type, Cube::dimensions> e;
 
             for (std::size_t i = 0; i < hc.dimensions; i++) {
                 std::tie(a, b) = hc.intervals[i];
@@ -53,7 +71,8 @@ namespace Integration {
 
         template <typename Cube>
         REGION_STATE contains(const Cube& hc) const {
-            long double temp, a, b;
+            static_assert(dimensions_match<N, Cube>, "The ellipsoid has a different number of variables");
+            real_type temp, a, b;
             std::size_t i;
 
             temp = 0;
@@ -77,54 +96,41 @@ namespace Integration {
             return INDEFINITE;
         }
 
-        template <typename Cube, typename Integral, typename Function>
-        Result<Cube> integrate(const Cube& cube, Integral Int, Function f,
-                               unsigned max_splits, bool return_cubes = false) const {
-            REGION_STATE state;
-            auto result = Result<Cube>{};
-            auto hc = std::make_shared<Cube>(cube);
-            result.origin = hc;
-            unsigned int depth = 0;
-
-            using cube_info = std::pair<std::shared_ptr<Cube>, unsigned int>;
-            std::queue<cube_info> cubes {{ { hc, depth } }};
-
-            for ( ; !cubes.empty(); cubes.pop()) {
-                std::tie(hc, depth) = cubes.front();
-                state = contains(*hc);
-
-                switch (state) {
-                    case INDEFINITE:
-                        if (depth >= max_splits) {
-                            const auto& [mlow, mhigh] = measure_estimates(*hc);
-                            const auto& [flow, fhigh] = f(*hc);
-                            result.sum += std::min(0.0L,  flow) * mhigh + std::max(0.0L,  flow) * mlow;
-                            result.error += ((std::max(0.0L, fhigh) - std::min(0.0L,  flow)) * mhigh +
-                                             (std::min(0.0L, fhigh) - std::max(0.0L,  flow)) * mlow);
-                        } else {
-                            depth++;
-                            for (auto p : hc->split())
-                                cubes.push({ p, depth });
-                            continue;
-                        }
-                        break;
-
-                    case CONTAINED:
-                        result.sum += Int(*hc);
-                        break;
-
-                    default:
-                        break;
-                }
-
-                // Destroy the cube unless return_cubes is true
-                if (return_cubes)
-                    result.cubes.push_back({ hc, state });
-            }
+        template <typename Cube>
+        std::pair<real_type, real_type> measure_estimates(const Cube& hc, const active_type&) const {
+            return measure_estimates(hc);
+        }
 
-            return result;
+        template <typename Cube>
+        REGION_STATE contains(const Cube& hc, active_type&) const {
+            return contains(hc);
+        }
+
+        // Operations per variable to classify a cube, for intersection
+        std::size_t classification_cost() const { return 2 * coeffs.size(); }
+
+        // Whether reflecting x_axis about point does not change the ellipsoid, for integrate_symmetric
+        bool symmetric(std::size_t axis, real_type point) const {
+            return coeffs[axis] == 0 || center[axis] == point;
+        }
+
+        // How much the equation changes along each dimension of the cube, the largest
+        // |a_i * (x_i - c_i)^2| derivative times the width, for integrate_kd
+        template <typename Cube>
+        std::array<real_type, Cube::dimensions> split_priorities(const Cube& hc, const active_type&) const {
+            std::array<real_type, Cube::dimensions> rv;
+            for (std::size_t i = 0; i < Cube::dimensions; i++) {
+                const auto& [a, b] = hc.intervals[i];
+                rv[i] = 2 * std::fabs(coeffs[i]) * std::max(std::fabs(a - center[i]), std::fabs(b - center[i])) * (b - a);
+            }
+            return rv;
         }
     };
+
+    using ellipsoid = basic_ellipsoid<extended_precision>;
+    // Ellipsoid in N variables, its coefficients and center are std::arrays
+    template <unsigned int N>
+    using fixed_ellipsoid = basic_ellipsoid<extended_precision, N>;
 }
 
 #endif // ELLIPSOID_H
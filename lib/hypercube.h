@@ -37,15 +37,40 @@ namespace Integration {
         // Split the current cube into 2^N smaller cubes
         auto split() const {
             parts_type parts;
-            const auto& product = interval_product();
-            for (std::size_t i = 0; i < product.size(); i++)
-                parts[i] = std::make_shared<HyperCube>(std::move(product[i]));
+            for (std::size_t i = 0; i < parts.size(); i++)
+                parts[i] = std::make_shared<HyperCube>(part(i));
 
             return parts;
         }
 
-        auto volume() const {
-            long double vol = 1;
+        // The i-th of the 2^N parts of the cube, without allocating. Bit N - 1 - k of i
+        // selects the half of the k-th interval, which is the order of split()
+        HyperCube part(std::size_t i) const {
+            HyperCube rv = *this;
+            for (std::size_t k = 0; k < N; k++) {
+                auto& [a, b] = rv.intervals[k];
+                T center = (a + b) / 2;
+                if (i >> (N - 1 - k) & 1)
+                    a = center;
+                else
+                    b = center;
+            }
+            return rv;
+        }
+
+        // The two halves of the cube along the k-th dimension, with the center of part()
+        std::pair<HyperCube, HyperCube> bisect(std::size_t k) const {
+            std::pair<HyperCube, HyperCube> rv{*this, *this};
+            const auto& [a, b] = intervals[k];
+            T center = (a + b) / 2;
+            rv.first.intervals[k].second = center;
+            rv.second.intervals[k].first = center;
+            return rv;
+        }
+
+        template <typename Real = long double>
+        Real volume() const {
+            Real vol = 1;
             for (const auto& [a, b] : intervals)
                 vol *= b - a;
             return vol;
@@ -62,32 +87,6 @@ namespace Integration {
         friend std::ostream &operator<<(std::ostream &os, const HyperCube& hc) {
             return hc.write(os);
         }
-
-
-    protected:
-        // Split each interval in half, return cartesian product of the halves
-        std::vector<intervals_type> interval_product() const {
-            std::size_t pos = 0;
-            std::vector<intervals_type> rv {{}};
-            for (const auto& [a, b] : intervals) {
-                std::vector<intervals_type> r;
-                T center = (a + b) / 2;
-
-                for (const auto& x : rv)  {
-                    // First half
-                    r.push_back(x);
-                    r.back()[pos] = {a, center};
-                    // Second half
-                    r.push_back(x);
-                    r.back()[pos] = {center, b};
-                }
-
-                rv = std::move(r);
-                pos++;
-            }
-
-            return rv;
-        }
     };
 }
 
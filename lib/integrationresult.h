@@ -1,19 +1,63 @@
 #ifndef INTEGRATIONRESULT_H
 #define INTEGRATIONRESULT_H
 
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <memory>
+#include <type_traits>
+#include <utility>
+#include "arena.h"
 #include "const.h"
+#include "precision.h"
 
 namespace Integration {
-    template<class Cube>
+    template<class Cube, typename Real = long double>
     struct Result
     {
-        std::vector<std::pair<std::shared_ptr<Cube>, REGION_STATE>> cubes;
-        long double sum, error;
+        std::vector<std::pair<const Cube*, REGION_STATE>> cubes;
+        compensated<Real> sum, error;
         std::shared_ptr<Cube> origin;
+        // Storage of the cubes above
+        std::shared_ptr<cube_arena<Cube>> arena;
     };
+
+    template <typename T>
+    struct is_bounded_integral : std::false_type { };
+
+    template <typename T, typename U>
+    struct is_bounded_integral<std::pair<T, U>> : std::true_type { };
+
+    // Contributions of a contained cube to the low estimate and to the error. Int(hc) is
+    // either the integral over the cube, or a pair of an approximation of it and a bound
+    // of the error of the approximation
+    template <typename Real, typename Value>
+    std::pair<Real, Real> integral_estimates(const Value& integral) {
+        if constexpr (is_bounded_integral<Value>::value)
+            return {Real(integral.first) - Real(integral.second), 2 * Real(integral.second)};
+        else
+            return {Real(integral), 0};
+    }
+
+    // Adds the integral over a contained cube, Int(hc), to a Result or morton_result
+    template <typename Results, typename Value>
+    void add_integral(Results& result, const Value& integral) {
+        using real_type = decltype(result.sum.value());
+        const auto& [low, error] = integral_estimates<real_type>(integral);
+        result.sum += low;
+        result.error += error;
+    }
+
+    // Contributions of a boundary cube to the low estimate and to the error, given
+    // [mlow, mhigh] bounds of the measure of the region within the cube and
+    // [flow, fhigh] bounds of the function at the cube
+    template <typename Real>
+    std::pair<Real, Real> boundary_estimates(Real mlow, Real mhigh, Real flow, Real fhigh) {
+        const Real zero = 0;
+        return {std::min(zero,  flow) * mhigh + std::max(zero,  flow) * mlow,
+                (std::max(zero, fhigh) - std::min(zero,  flow)) * mhigh +
+                (std::min(zero, fhigh) - std::max(zero,  flow)) * mlow};
+    }
 }
 
 #endif // INTEGRATIONRESULT_H
@@ -0,0 +1,400 @@
+#ifndef INTERSECTION_H
+#define INTERSECTION_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "const.h"
+#include "kd.h"
+#include "region.h"
+#include "symmetry.h"
+#include "traversal.h"
+
+/* Intersection of regions, e.g. of a polygon and an ellipsoid for a truncated ellipse.
+ * A cube is rejected as soon as one of the regions rejects it, and is contained once all
+ * of them contain it. Every region a cube's parent was contained in is dropped from it,
+ * and every region keeps its own constraints of the cube, so each of them prunes as it
+ * does on its own.
+ * The regions are checked cheapest and most likely to reject first. The order is
+ * learned from the rejection rates counted during the integration, weighed by the
+ * classification_cost() of each region if it has one. It only changes how soon a
+ * rejected cube is found, the results do not depend on it
+ */
+
+namespace Integration {
+    template <typename Region, typename = void>
+    struct has_classification_cost : std::false_type { };
+
+    template <typename Region>
+    struct has_classification_cost<Region, std::void_t<decltype(
+        std::declval<const Region&>().classification_cost())>> : std::true_type { };
+
+    // How often a region of an intersection was checked, and how often it rejected
+    // or contained the cube
+    struct constraint_statistics {
+        std::uint64_t checks = 0, rejections = 0, containments = 0;
+    };
+
+    template <typename... Regions>
+    class intersection : public integrable_region<intersection<Regions...>> {
+    public:
+        static constexpr std::size_t count = sizeof...(Regions);
+        static_assert(count > 0 && count <= 16, "An intersection is of 1 to 16 regions");
+
+        using real_type = std::common_type_t<typename Regions::real_type...>;
+
+        // The constraints of every region, and a bit for each region that does not contain the cube yet
+        struct active_type {
+            std::tuple<typename Regions::active_type...> constraints;
+            std::uint32_t remaining = 0;
+        };
+
+        intersection(Regions... _regions) : regions(std::move(_regions)...) {
+            std::uint64_t packed = 0;
+            for (std::size_t k = 0; k < count; k++)
+                packed |= std::uint64_t(k) << (4 * k);
+            order.store(packed, std::memory_order_relaxed);
+        }
+
+        intersection(const intersection& other)
+                : regions(other.regions), order(other.order.load(std::memory_order_relaxed)),
+                  shards(other.shards) { }
+
+        intersection& operator=(const intersection& other) {
+            regions = other.regions;
+            order.store(other.order.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            shards = other.shards;
+            return *this;
+        }
+
+        template <std::size_t K>
+        const auto& region() const { return std::get<K>(regions); }
+
+        // Counts of each region so far
+        std::array<constraint_statistics, count> statistics() const {
+            std::array<constraint_statistics, count> rv{};
+            for (const auto& shard : shards) {
+                for (std::size_t k = 0; k < count; k++) {
+                    const auto& values = shard.counters[k].load();
+                    rv[k].checks += values.checks;
+                    rv[k].rejections += values.rejections;
+                    rv[k].containments += values.containments;
+                }
+            }
+            return rv;
+        }
+
+        // Indices of the regions in the order they are checked in
+        std::array<std::size_t, count> check_order() const {
+            std::array<std::size_t, count> rv;
+            const std::uint64_t packed = order.load(std::memory_order_relaxed);
+            for (std::size_t k = 0; k < count; k++)
+                rv[k] = (packed >> (4 * k)) & 15;
+            return rv;
+        }
+
+        active_type boundaries() const {
+            active_type rv;
+            rv.constraints = std::apply([](const auto&... region) {
+                return std::make_tuple(region.boundaries()...);
+            }, regions);
+            rv.remaining = (std::uint32_t(1) << count) - 1;
+            return rv;
+        }
+
+        template <typename Cube>
+        REGION_STATE contains(const Cube& hc, active_type& active) const {
+            std::array<constraint_statistics, count> local{};
+            REGION_STATE rv = CONTAINED;
+
+            for (std::size_t k : check_order()) {
+                if (!(active.remaining & (std::uint32_t(1) << k)))
+                    continue;
+
+                REGION_STATE state = INDEFINITE;
+                with_region(k, [&](auto index) {
+                    constexpr std::size_t K = decltype(index)::value;
+                    state = std::get<K>(regions).contains(hc, std::get<K>(active.constraints));
+                });
+
+                local[k].checks++;
+                if (state == REJECTED) {
+                    local[k].rejections++;
+                    rv = REJECTED;
+                    break;
+                }
+                if (state == CONTAINED) {
+                    local[k].containments++;
+                    active.remaining &= ~(std::uint32_t(1) << k);
+                } else {
+                    rv = INDEFINITE;
+                }
+            }
+
+            record(local, 1);
+            return rv;
+        }
+
+        // All parts of the cube, one region at a time in the order of check_order(). A region
+        // classifies all parts in one batch if it provides contains_parts, otherwise only the
+        // parts the regions before it did not reject
+        template <typename Cube>
+        void contains_parts(const Cube& hc, const active_type& active,
+                            std::array<REGION_STATE, std::size_t(1) << Cube::dimensions>& states,
+                            std::array<active_type, std::size_t(1) << Cube::dimensions>& actives) const {
+            constexpr std::size_t parts = std::size_t(1) << Cube::dimensions;
+            std::array<constraint_statistics, count> local{};
+            std::size_t rejected = 0;
+            states.fill(CONTAINED);
+            actives.fill(active);
+
+            for (std::size_t k : check_order()) {
+                if (!(active.remaining & (std::uint32_t(1) << k)) || rejected == parts)
+                    continue;
+
+                with_region(k, [&](auto index) {
+                    constexpr std::size_t K = decltype(index)::value;
+                    using region_type = std::tuple_element_t<K, std::tuple<Regions...>>;
+                    const auto& region = std::get<K>(regions);
+
+                    std::array<REGION_STATE, parts> part_states;
+                    std::array<typename region_type::active_type, parts> part_actives;
+                    if constexpr (has_contains_parts<region_type, Cube>::value) {
+                        region.contains_parts(hc, std::get<K>(active.constraints), part_states, part_actives);
+                        // Only the parts still undecided count, as only their rejections do
+                        local[k].checks += parts - rejected;
+                    } else {
+                        for (std::size_t i = 0; i < parts; i++) {
+                            if (states[i] == REJECTED)
+                                continue;
+                            part_actives[i] = std::get<K>(active.constraints);
+                            part_states[i] = region.contains(hc.part(i), part_actives[i]);
+                            local[k].checks++;
+                        }
+                    }
+
+                    for (std::size_t i = 0; i < parts; i++) {
+                        if (states[i] == REJECTED)
+                            continue;
+                        std::get<K>(actives[i].constraints) = std::move(part_actives[i]);
+                        if (part_states[i] == REJECTED) {
+                            local[k].rejections++;
+                            states[i] = REJECTED;
+                            rejected++;
+                        } else if (part_states[i] == CONTAINED) {
+                            local[k].containments++;
+                            actives[i].remaining &= ~(std::uint32_t(1) << k);
+                        } else {
+                            states[i] = INDEFINITE;
+                        }
+                    }
+                });
+            }
+
+            record(local, parts);
+        }
+
+        // The bounds of the only region left if there is one, otherwise the smallest upper bound
+        // and the sum of the lower bounds less the volume of the cube per additional region
+        template <typename Cube>
+        std::pair<real_type, real_type> measure_estimates(const Cube& hc, const active_type& active) const {
+            real_type volume = 1;
+            for (const auto& [a, b] : hc.intervals)
+                volume *= real_type(b) - real_type(a);
+
+            std::size_t remaining = 0;
+            real_type low = 0, high = volume;
+            for_each_region([&](auto index) {
+                constexpr std::size_t K = decltype(index)::value;
+                if (!(active.remaining & (std::uint32_t(1) << K)))
+                    return;
+                const auto& [mlow, mhigh] = std::get<K>(regions).measure_estimates(hc, std::get<K>(active.constraints));
+                if (remaining++ > 0)
+                    low -= volume;
+                low += mlow;
+                high = std::min(high, real_type(mhigh));
+            });
+
+            return {std::clamp(low, real_type(0), high), high};
+        }
+
+        // Sum of the split priorities of the remaining regions, each divided by its largest
+        // one as regions measure them in different units. The widths for regions without them
+        template <typename Cube>
+        std::array<real_type, Cube::dimensions> split_priorities(const Cube& hc, const active_type& active) const {
+            std::array<real_type, Cube::dimensions> rv{};
+            for_each_region([&](auto index) {
+                constexpr std::size_t K = decltype(index)::value;
+                using region_type = std::tuple_element_t<K, std::tuple<Regions...>>;
+                if (!(active.remaining & (std::uint32_t(1) << K)))
+                    return;
+
+                std::array<real_type, Cube::dimensions> priorities;
+                if constexpr (has_split_priorities<region_type, Cube>::value) {
+                    const auto& own = std::get<K>(regions).split_priorities(hc, std::get<K>(active.constraints));
+                    std::copy(own.begin(), own.end(), priorities.begin());
+                } else {
+                    for (std::size_t i = 0; i < Cube::dimensions; i++)
+                        priorities[i] = hc.intervals[i].second - hc.intervals[i].first;
+                }
+
+                const real_type largest = *std::max_element(priorities.begin(), priorities.end());
+                if (largest > 0)
+                    for (std::size_t i = 0; i < Cube::dimensions; i++)
+                        rv[i] += priorities[i] / largest;
+            });
+            return rv;
+        }
+
+        // Whether all regions are symmetric, for integrate_symmetric
+        bool symmetric(std::size_t axis, real_type center) const {
+            bool rv = true;
+            for_each_region([&](auto index) {
+                constexpr std::size_t K = decltype(index)::value;
+                using region_type = std::tuple_element_t<K, std::tuple<Regions...>>;
+                if constexpr (has_symmetric<region_type>::value)
+                    rv = rv && std::get<K>(regions).symmetric(axis, center);
+                else
+                    rv = false;
+            });
+            return rv;
+        }
+
+        // The costs of the regions together
+        real_type classification_cost() const {
+            real_type rv = 0;
+            for_each_region([&](auto index) { rv += cost<decltype(index)::value>(); });
+            return rv;
+        }
+
+    private:
+        // Statistics of a region in a shard
+        struct atomic_statistics {
+            std::atomic<std::uint64_t> checks{0}, rejections{0}, containments{0};
+
+            atomic_statistics() = default;
+            atomic_statistics(const atomic_statistics& other) { *this = other; }
+            atomic_statistics& operator=(const atomic_statistics& other) {
+                const auto& values = other.load();
+                checks.store(values.checks, std::memory_order_relaxed);
+                rejections.store(values.rejections, std::memory_order_relaxed);
+                containments.store(values.containments, std::memory_order_relaxed);
+                return *this;
+            }
+
+            constraint_statistics load() const {
+                return { checks.load(std::memory_order_relaxed), rejections.load(std::memory_order_relaxed),
+                         containments.load(std::memory_order_relaxed) };
+            }
+        };
+
+        // Statistics counted by some of the threads, on a cache line of their own. Each thread
+        // counts in one shard, so that threads do not contend for the same counters
+        struct alignas(64) statistics_shard {
+            std::array<atomic_statistics, count> counters;
+            // Cubes classified, the weights of record
+            std::atomic<std::uint64_t> calls{0};
+
+            statistics_shard() = default;
+            statistics_shard(const statistics_shard& other) : counters(other.counters) { }
+            statistics_shard& operator=(const statistics_shard& other) {
+                counters = other.counters;
+                return *this;
+            }
+        };
+
+        static constexpr std::size_t shard_count = 16;
+
+        // The order is recomputed after this many cubes are classified in a shard
+        static constexpr std::uint64_t reorder_interval = 1024;
+
+        std::tuple<Regions...> regions;
+        // check_order(), 4 bits per index
+        mutable std::atomic<std::uint64_t> order;
+        mutable std::array<statistics_shard, shard_count> shards;
+
+        // The shard of the calling thread, assigned when it first counts
+        static statistics_shard& own_shard(std::array<statistics_shard, shard_count>& shards) {
+            static std::atomic<std::size_t> threads{0};
+            thread_local const std::size_t index = threads.fetch_add(1, std::memory_order_relaxed) % shard_count;
+            return shards[index];
+        }
+
+        // visit(std::integral_constant<std::size_t, k>) for every k
+        template <typename Visit>
+        void for_each_region(Visit visit) const {
+            for_each_index(visit, std::make_index_sequence<count>{});
+        }
+
+        template <typename Visit, std::size_t... K>
+        static void for_each_index(Visit& visit, std::index_sequence<K...>) {
+            (visit(std::integral_constant<std::size_t, K>{}), ...);
+        }
+
+        // visit(std::integral_constant<std::size_t, k>) for the k known at runtime
+        template <typename Visit>
+        void with_region(std::size_t k, Visit visit) const {
+            for_each_region([&](auto index) {
+                if (decltype(index)::value == k)
+                    visit(index);
+            });
+        }
+
+        template <std::size_t K>
+        real_type cost() const {
+            using region_type = std::tuple_element_t<K, std::tuple<Regions...>>;
+            if constexpr (has_classification_cost<region_type>::value)
+                return std::max(real_type(std::get<K>(regions).classification_cost()), real_type(1));
+            else
+                return 1;
+        }
+
+        // Adds the counts of one call of contains or contains_parts, which classified weight cubes
+        void record(const std::array<constraint_statistics, count>& local, std::uint64_t weight) const {
+            auto& shard = own_shard(shards);
+            for (std::size_t k = 0; k < count; k++) {
+                if (local[k].checks == 0)
+                    continue;
+                auto& counters = shard.counters[k];
+                counters.checks.fetch_add(local[k].checks, std::memory_order_relaxed);
+                if (local[k].rejections)
+                    counters.rejections.fetch_add(local[k].rejections, std::memory_order_relaxed);
+                if (local[k].containments)
+                    counters.containments.fetch_add(local[k].containments, std::memory_order_relaxed);
+            }
+
+            const std::uint64_t before = shard.calls.fetch_add(weight, std::memory_order_relaxed);
+            if ((before + weight) / reorder_interval != before / reorder_interval)
+                reorder();
+        }
+
+        // Ascending cost per probability of rejection, the order that finds a rejecting region
+        // with the least expected cost if the regions reject independently
+        void reorder() const {
+            const auto& counts = statistics();
+            std::array<real_type, count> keys;
+            for_each_region([&](auto index) {
+                constexpr std::size_t K = decltype(index)::value;
+                const auto& values = counts[K];
+                // Laplace's rule, so that a region that never rejected is still ordered by cost
+                const real_type rate = (real_type(values.rejections) + 1) / (real_type(values.checks) + 2);
+                keys[K] = cost<K>() / rate;
+            });
+
+            auto indices = check_order();
+            std::stable_sort(indices.begin(), indices.end(),
+                             [&](std::size_t i, std::size_t j) { return keys[i] < keys[j]; });
+            std::uint64_t packed = 0;
+            for (std::size_t k = 0; k < count; k++)
+                packed |= std::uint64_t(indices[k]) << (4 * k);
+            order.store(packed, std::memory_order_relaxed);
+        }
+    };
+}
+
+#endif // INTERSECTION_H
@@ -0,0 +1,114 @@
+#ifndef KD_H
+#define KD_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include "const.h"
+#include "integrationresult.h"
+
+/* Integration over a kd-tree: a boundary cube is bisected along a single dimension,
+ * the one along which the region changes the most within it, instead of being split
+ * into 2^N parts. In higher dimensions the boundary usually depends on a few directions
+ * within a small cube, and halving the others only multiplies the number of cubes
+ */
+
+namespace Integration {
+    template <typename Region, typename Cube, typename = void>
+    struct has_split_priorities : std::false_type { };
+
+    template <typename Region, typename Cube>
+    struct has_split_priorities<Region, Cube, std::void_t<decltype(
+        std::declval<const Region&>().split_priorities(
+            std::declval<const Cube&>(), std::declval<const typename Region::active_type&>()))>>
+        : std::true_type { };
+
+    // Same as region.integrate(cube, Int, f, max_splits, return_cubes), but a boundary cube is
+    // bisected along the dimension with the largest region.split_priorities(hc, active), or
+    // the widest one if the region has none. Boundary cubes are bisected N * max_splits times,
+    // so they end up with the same volume as those of integrate, but not the same shape
+    template <typename Region, typename Cube, typename Integral, typename Function>
+    Result<Cube, typename Region::real_type> integrate_kd(const Region& region, const Cube& cube,
+                                                          Integral Int, Function f, unsigned max_splits,
+                                                          bool return_cubes = false) {
+        using real_type = typename Region::real_type;
+        using active_type = typename Region::active_type;
+        constexpr std::size_t N = Cube::dimensions;
+
+        const unsigned int max_depth = max_splits * N;
+
+        struct cube_info {
+            Cube* hc;
+            unsigned int depth;
+            active_type active;
+            REGION_STATE state;
+        };
+
+        auto result = Result<Cube, real_type>{};
+        result.origin = std::make_shared<Cube>(cube);
+        result.arena = std::make_shared<cube_arena<Cube>>();
+        auto& arena = *result.arena;
+
+        auto root = region.boundaries();
+        REGION_STATE root_state = region.contains(cube, root);
+        std::queue<cube_info> cubes {{ { arena.make(cube), 0, std::move(root), root_state } }};
+
+        for ( ; !cubes.empty(); cubes.pop()) {
+            auto& [hc, depth, active, state] = cubes.front();
+
+            switch (state) {
+                case INDEFINITE: {
+                    if (depth >= max_depth) {
+                        const auto& [mlow, mhigh] = region.measure_estimates(*hc, active);
+                        const auto& [flow, fhigh] = f(*hc);
+                        const auto& [low, error] = boundary_estimates<real_type>(mlow, mhigh, flow, fhigh);
+                        result.sum += low;
+                        result.error += error;
+                        break;
+                    }
+
+                    std::array<real_type, N> priorities;
+                    if constexpr (has_split_priorities<Region, Cube>::value) {
+                        priorities = region.split_priorities(*hc, active);
+                    } else {
+                        for (std::size_t k = 0; k < N; k++)
+                            priorities[k] = hc->intervals[k].second - hc->intervals[k].first;
+                    }
+
+                    std::size_t axis = 0;
+                    for (std::size_t k = 1; k < N; k++)
+                        if (priorities[k] > priorities[axis])
+                            axis = k;
+
+                    const auto& [first, second] = hc->bisect(axis);
+                    for (const Cube& half : { first, second }) {
+                        auto part_active = active;
+                        REGION_STATE part_state = region.contains(half, part_active);
+                        cubes.push({ arena.make(half), depth + 1, std::move(part_active), part_state });
+                    }
+                    arena.release(hc);
+                    continue;
+                }
+
+                case CONTAINED:
+                    add_integral(result, Int(*hc));
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (return_cubes)
+                result.cubes.push_back({ hc, state });
+            else
+                arena.release(hc);
+        }
+
+        return result;
+    }
+}
+
+#endif // KD_H
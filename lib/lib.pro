@@ -3,7 +3,7 @@ QT += widgets
 
 TARGET = lib
 TEMPLATE = lib
-CONFIG += staticlib c++1z -Wall
+CONFIG += staticlib c++1z thread -Wall
 
 HEADERS += const.h \
            hypercube.h \
@@ -13,7 +13,26 @@ HEADERS += const.h \
     normal_distribution.h \
     power_product.h \
     linear.h \
-    2d_viewer.h
+    2d_viewer.h \
+    adaptive.h \
+    parallel.h \
+    arena.h \
+    traversal.h \
+    precision.h \
+    dimensions.h \
+    compiled_region.h \
+    multi_region.h \
+    morton.h \
+    kd.h \
+    sinks.h \
+    storage.h \
+    resumable.h \
+    polynomial.h \
+    multivariate_normal.h \
+    quadric.h \
+    region.h \
+    intersection.h \
+    symmetry.h
 
 unix {
     target.path = /usr/lib
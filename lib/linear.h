@@ -4,18 +4,23 @@
 #include <algorithm>
 #include <array>
 #include <cstddef>
-#include <functional>
+#include <cmath>
+#include <limits>
+#include <type_traits>
 #include <utility>
-#include <vector>
+#include "const.h"
+#include "dimensions.h"
 
 namespace Integration {
-    // <vector of coefficients (e), number (d)> pair representing linear equations
-    using linear_equation = std::pair<std::vector<long double>, long double>;
+    // <vector of coefficients (e), number (d)> pair representing linear equations,
+    // of N variables or of any number of them (see dimensions.h)
+    template <typename Real, unsigned int N = dynamic_dimensions>
+    using basic_linear_equation = std::pair<coefficients_t<Real, N>, Real>;
+    using linear_equation = basic_linear_equation<long double>;
 
     // Maximum of <e, x> + d at hc
-    auto linear_max(const auto& hc, const linear_equation::first_type& e,
-                    const linear_equation::second_type& d) {
-        long double rv = d;
+    auto linear_max(const auto& hc, const auto& e, const auto& d) {
+        std::decay_t<decltype(d)> rv = d;
         for (std::size_t i = 0; i < hc.dimensions; i++) {
             const auto& [a, b] = hc.intervals[i];
             rv += e[i] * (e[i] >= 0 ? b : a);
@@ -24,9 +29,8 @@ namespace Integration {
     }
 
     // Minimum of <e, x> + d at hc
-    auto linear_min(const auto& hc, const linear_equation::first_type& e,
-                    const linear_equation::second_type& d) {
-        long double rv = d;
+    auto linear_min(const auto& hc, const auto& e, const auto& d) {
+        std::decay_t<decltype(d)> rv = d;
         for (std::size_t i = 0; i < hc.dimensions; i++) {
             const auto& [a, b] = hc.intervals[i];
             rv += e[i] * (e[i] >= 0 ? a : b);
@@ -34,17 +38,80 @@ namespace Integration {
         return rv;
     }
 
-    // Measure of the cube with one linear restriction <e, x> + d <= 0 applied
-    auto single_section_measure(const auto& hc, const linear_equation::first_type& e,
-                                const linear_equation::second_type& d) {
-        long double min = 0, max = 0, en = 0;
-        std::array<long double, hc.dimensions> u, v;
-        std::array<bool, hc.dimensions> is_active;
-        is_active.fill(true);
+    // The 2^N parts of a cube (in the order of HyperCube::part) in structure-of-arrays form:
+    // lower[i][k] and upper[i][k] are the ends of the i-th interval of the k-th part
+    template <unsigned int N, typename Scalar = double>
+    struct parts_batch {
+        static constexpr std::size_t size = std::size_t(1) << N;
+        std::array<std::array<Scalar, size>, N> lower, upper;
+        // Largest |x_i| in the cube
+        std::array<Scalar, N> magnitude;
+
+        template <typename Cube>
+        explicit parts_batch(const Cube& hc) {
+            for (std::size_t i = 0; i < N; i++) {
+                const auto& [a, b] = hc.intervals[i];
+                const auto center = (a + b) / 2;
+                for (std::size_t k = 0; k < size; k++) {
+                    const bool second = k >> (N - 1 - i) & 1;
+                    lower[i][k] = second ? center : a;
+                    upper[i][k] = second ? b : center;
+                }
+                magnitude[i] = std::max(std::fabs(Scalar(a)), std::fabs(Scalar(b)));
+            }
+        }
+    };
+
+    // Minima and maxima of <e, x> + d at all parts of the batch, in the precision of the batch.
+    // The sign of e[i] picks the ends of the i-th intervals once per equation,
+    // the rest are multiply-adds over contiguous arrays of parts
+    template <unsigned int N, typename Scalar>
+    void linear_minmax_batch(const parts_batch<N, Scalar>& parts,
+                             const std::array<Scalar, std::size_t(N)>& e, Scalar d,
+                             std::array<Scalar, parts_batch<N, Scalar>::size>& min,
+                             std::array<Scalar, parts_batch<N, Scalar>::size>& max) {
+        min.fill(d);
+        max.fill(d);
+        for (std::size_t i = 0; i < N; i++) {
+            const auto& low = e[i] >= 0 ? parts.lower[i] : parts.upper[i];
+            const auto& high = e[i] >= 0 ? parts.upper[i] : parts.lower[i];
+            for (std::size_t k = 0; k < parts_batch<N, Scalar>::size; k++) {
+                min[k] += e[i] * low[k];
+                max[k] += e[i] * high[k];
+            }
+        }
+    }
+
+    // Bound of the difference between linear_minmax_batch and the values of linear_min and
+    // linear_max computed in Real, counting the rounding of e, d and x to Scalar, of each product
+    // and each addition in both precisions, with some headroom
+    template <typename Real, unsigned int N, typename Scalar>
+    Scalar linear_batch_error(const parts_batch<N, Scalar>& parts,
+                              const std::array<Scalar, std::size_t(N)>& e, Scalar d) {
+        Scalar magnitude = std::fabs(d);
+        for (std::size_t i = 0; i < N; i++)
+            magnitude += std::fabs(e[i]) * parts.magnitude[i];
+        const Scalar epsilon = std::numeric_limits<Scalar>::epsilon() + std::numeric_limits<Real>::epsilon();
+        return (N + 3) * (epsilon * magnitude + std::numeric_limits<Scalar>::min());
+    }
+
+    // Measure of the cube with one linear restriction <e, x> + d <= 0 applied.
+    // The measure is expanded recursively over the faces of the cube. A face is determined
+    // by the dimensions that are still active and the endpoint every other dimension
+    // is fixed at, so there are 3^N distinct faces, and each one is measured only once
+    auto single_section_measure(const auto& hc, const auto& e, const auto& d) {
+        using Real = std::decay_t<decltype(d)>;
+        constexpr std::size_t dimensions = std::decay_t<decltype(hc)>::dimensions;
+        Real min = 0, max = 0, en = 0;
+        std::array<Real, dimensions> u, v;
+        // Faces are numbered in base 3: digit i is 0 if dimension i is active,
+        // 1 if it is fixed at a, and 2 if it is fixed at b
+        std::array<std::size_t, dimensions> digit;
+        std::size_t faces = 1;
 
         // Calculate the minimum and maximum of <e, x> + d at the cube
         // en is ||<e, e>||
-        for (std::size_t i = 0; i < hc.dimensions; i++) {
+        for (std::size_t i = 0; i < dimensions; i++) {
             const auto& [a, b] = hc.intervals[i];
             if (e[i] >= 0) {
                 min += (u[i] = a) * e[i];
@@ -54,17 +121,28 @@ namespace Integration {
                 max += (v[i] = a) * e[i];
             }
             en += e[i] * e[i];
+            digit[i] = faces;
+            faces *= 3;
         }
 
-        std::function<long double(long double, long double, long double, long double)> f;
+        if (max + d <= 0)
+            return hc.template volume<Real>();
+        else if (min + d >= 0)
+            return Real(0);
+
+        // Measures of the faces already expanded, on the stack as there are few dimensions
+        std::array<Real, ipow(3, dimensions)> measures;
+        std::array<bool, ipow(3, dimensions)> measured {};
 
-        f = [&](long double d, long double min, long double max, long double en) -> long double {
-            std::size_t i, active = std::count(is_active.begin(), is_active.end(), true);
+        auto f = [&](auto& self, std::size_t face, std::size_t active, Real d,
+                     Real min, Real max, Real en) -> Real {
+            std::size_t i;
+            auto is_active = [&](std::size_t i) { return face / digit[i] % 3 == 0; };
 
             if (max + d <= 0) {
-                long double prod = 1;
-                for (i = 0; i < is_active.size(); i++) {
-                    if (is_active[i]) {
+                Real prod = 1;
+                for (i = 0; i < dimensions; i++) {
+                    if (is_active(i)) {
                         const auto& [a, b] = hc.intervals[i];
                         prod *= b - a;
                     }
@@ -75,15 +153,15 @@ namespace Integration {
                 return 0;
 
             } else if (active == 1) {
-                for (i = 0; i < is_active.size(); i++)
-                    if (is_active[i])
+                for (i = 0; i < dimensions; i++)
+                    if (is_active(i))
                         break;
 
                 const auto& [a, b] = hc.intervals[i];
                 if (e[i] == 0) {
                     return (d > 0) ? 0 : b - a;
                 } else {
-                    long double u = -d/e[i];
+                    Real u = -d/e[i];
                     if (e[i] < 0) {
                         if (u >= b) return 0;
                         else if (u <= a) return b - a;
@@ -95,29 +173,33 @@ namespace Integration {
                     }
                 }
 
+            } else if (measured[face]) {
+                return measures[face];
+
             } else {
-                long double t = -(max + d) / en, rv = 0,
+                Real t = -(max + d) / en, rv = 0,
                             w, corrected_min, corrected_max, corrected_en;
-                for (i = 0; i < is_active.size(); i++) {
-                    if (is_active[i]) {
+                for (i = 0; i < dimensions; i++) {
+                    if (is_active(i)) {
                         const auto& [a, b] = hc.intervals[i];
                         corrected_min = min - u[i] * e[i];
                         corrected_max = max - v[i] * e[i];
                         corrected_en = en - e[i] * e[i];
                         w = v[i] + t * e[i];
 
-                        is_active[i] = false;
-                        rv += f(d + a * e[i], corrected_min, corrected_max, corrected_en) * (w - a) / active;
-                        rv += f(d + b * e[i], corrected_min, corrected_max, corrected_en) * (b - w) / active;
-                        is_active[i] = true;
+                        rv += self(self, face + digit[i], active - 1, d + a * e[i],
+                                   corrected_min, corrected_max, corrected_en) * (w - a) / active;
+                        rv += self(self, face + 2 * digit[i], active - 1, d + b * e[i],
+                                   corrected_min, corrected_max, corrected_en) * (b - w) / active;
                     }
                 }
 
-                return rv;
+                measured[face] = true;
+                return measures[face] = rv;
             }
         };
 
-        return f(d, min, max, en);
+        return f(f, 0, dimensions, d, min, max, en);
 
     }
 }
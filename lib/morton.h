@@ -0,0 +1,267 @@
+#ifndef MORTON_H
+#define MORTON_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+#if __cplusplus > 201703L && __has_include(<bit>)
+#include <bit>
+#endif
+#include "const.h"
+#include "integrationresult.h"
+#include "precision.h"
+#include "traversal.h"
+
+/* Cubes of the subdivision tree identified by their position in it instead of
+ * their intervals. The code of a cube is a leading 1 bit followed by the indices of
+ * the parts (see HyperCube::part) taken at every level from the root, N bits each,
+ * i.e. the Z-order index of the cube among the cubes of its level
+ */
+
+namespace Integration {
+    namespace morton_detail {
+        // The top 6 bits of (2^(i + 1) - 1) * debruijn are different for every i < 64
+        constexpr std::uint64_t debruijn = 0x03f79d71b4cb0a89;
+
+        constexpr std::array<unsigned char, 64> make_log2_table() {
+            std::array<unsigned char, 64> table {};
+            for (unsigned int i = 0; i < 64; i++)
+                table[((std::uint64_t(2) << i) - 1) * debruijn >> 58] = i;
+            return table;
+        }
+
+        constexpr std::array<unsigned char, 64> log2_table = make_log2_table();
+
+        // Index of the highest set bit of x > 0
+        constexpr unsigned int log2(std::uint64_t x) {
+#if defined(__cpp_lib_bitops)
+            return std::bit_width(x) - 1;
+#else
+            // Sets all bits below the highest one, then looks the result up
+            x |= x >> 1;
+            x |= x >> 2;
+            x |= x >> 4;
+            x |= x >> 8;
+            x |= x >> 16;
+            x |= x >> 32;
+            return log2_table[x * debruijn >> 58];
+#endif
+        }
+    }
+
+    template <unsigned int N>
+    class morton_cube {
+    public:
+        static constexpr unsigned int max_level = 63 / N;
+
+        // The root cube
+        morton_cube() : code(1) { }
+
+        explicit morton_cube(std::uint64_t code) : code(code) { }
+
+        std::uint64_t bits() const { return code; }
+
+        unsigned int level() const {
+            // The code is a 1 followed by N bits per level
+            return morton_detail::log2(code) / N;
+        }
+
+        // The i-th part of the cube, in the order of HyperCube::part
+        morton_cube child(std::size_t i) const {
+            assert(level() < max_level);
+            return morton_cube(code << N | i);
+        }
+
+        morton_cube parent() const {
+            assert(level() > 0);
+            return morton_cube(code >> N);
+        }
+
+        // Index of the cube along the k-th dimension among the 2^level() cubes of its level
+        std::uint64_t coordinate(std::size_t k) const {
+            // The bits of the dimension are N apart, and are moved together in groups
+            // of 1, 2, 4, ... bits, i.e. in 6 steps for any level
+            std::uint64_t rv = (code & axis_mask(k)) >> (N - 1 - k);
+            for (std::size_t t = 0; t + 1 < compact_masks.size(); t++)
+                rv = (rv | rv >> ((N - 1) << t)) & compact_masks[t + 1];
+            return rv;
+        }
+
+        // The cube of the same level next to this one along the k-th dimension, in the
+        // positive or negative direction, if it is still within the root
+        std::optional<morton_cube> neighbour(std::size_t k, bool positive) const {
+            const std::uint64_t mask = axis_mask(k);
+
+            // Adding or subtracting 1 to the interleaved bits of the dimension only,
+            // the carries skip the bits of the other dimensions
+            const std::uint64_t x = code & mask;
+            if (positive ? x == mask : x == 0)
+                return std::nullopt;
+            const std::uint64_t y = positive ? ((x | ~mask) + 1) & mask : (x - 1) & mask;
+            return morton_cube((code & ~mask) | y);
+        }
+
+        // The intervals of the cube within root, with the same midpoints as HyperCube::split
+        template <typename Cube>
+        Cube cube(const Cube& root) const {
+            static_assert(Cube::dimensions == N, "The root has a different dimension");
+            Cube rv = root;
+            const unsigned int l = level();
+            for (std::size_t k = 0; k < N; k++) {
+                auto& [a, b] = rv.intervals[k];
+                for (unsigned int j = l; j-- > 0; ) {
+                    const auto center = (a + b) / 2;
+                    if (code >> (j * N + N - 1 - k) & 1)
+                        a = center;
+                    else
+                        b = center;
+                }
+            }
+            return rv;
+        }
+
+        // Cubes of a level are ordered along the Z-order curve, and before their parts
+        bool operator<(const morton_cube& other) const {
+            const unsigned int l = level(), m = other.level();
+            return l <= m ? code < other.code >> (m - l) * N || (code == other.code >> (m - l) * N && l < m)
+                          : code >> (l - m) * N < other.code;
+        }
+
+        bool operator==(const morton_cube& other) const { return code == other.code; }
+        bool operator!=(const morton_cube& other) const { return code != other.code; }
+
+    private:
+        std::uint64_t code;
+
+        // Bits of the k-th dimension at every level up to max_level
+        static constexpr std::array<std::uint64_t, N> make_axis_masks() {
+            std::array<std::uint64_t, N> masks {};
+            for (unsigned int k = 0; k < N; k++)
+                for (unsigned int j = 0; j < max_level; j++)
+                    masks[k] |= std::uint64_t(1) << (j * N + N - 1 - k);
+            return masks;
+        }
+
+        // The t-th mask keeps groups of 2^t bits, 2^t * N bits apart
+        static constexpr std::array<std::uint64_t, 7> make_compact_masks() {
+            std::array<std::uint64_t, 7> masks {};
+            for (unsigned int t = 0; t < masks.size(); t++)
+                for (unsigned int p = 0; p < 64; p++)
+                    if (p % ((std::uint64_t(1) << t) * N) < (std::uint64_t(1) << t))
+                        masks[t] |= std::uint64_t(1) << p;
+            return masks;
+        }
+
+        static constexpr std::array<std::uint64_t, N> axis_masks = make_axis_masks();
+        static constexpr std::array<std::uint64_t, 7> compact_masks = make_compact_masks();
+
+        // Bits of the k-th dimension in the code, below its leading 1
+        std::uint64_t axis_mask(std::size_t k) const {
+            return axis_masks[k] & ((std::uint64_t(1) << level() * N) - 1);
+        }
+    };
+
+    // Same as Result, with the cubes kept as their codes within origin
+    template <typename Cube, typename Real = long double>
+    struct morton_result {
+        std::vector<std::pair<morton_cube<Cube::dimensions>, REGION_STATE>> cubes;
+        compensated<Real> sum, error;
+        std::shared_ptr<Cube> origin;
+
+        Cube cube(const morton_cube<Cube::dimensions>& code) const {
+            return code.cube(*origin);
+        }
+
+        // The Result with the intervals of all cubes, e.g. for view_result
+        Result<Cube, Real> expand() const {
+            auto result = Result<Cube, Real>{};
+            result.sum = sum;
+            result.error = error;
+            result.origin = origin;
+            result.arena = std::make_shared<cube_arena<Cube>>();
+            result.cubes.reserve(cubes.size());
+            for (const auto& [code, state] : cubes)
+                result.cubes.push_back({ result.arena->make(cube(code)), state });
+            return result;
+        }
+    };
+
+    // Same as region.integrate(cube, Int, f, max_splits, return_cubes, order), with the cubes
+    // waiting in the queue and the returned ones stored as their codes. Cubes are computed
+    // from their codes when they are visited, and are the same as HyperCube::split gives,
+    // so are the sum and the error. Throws std::invalid_argument if max_splits is more than
+    // morton_cube<N>::max_level, the deepest level a code has the bits for
+    template <typename Region, typename Cube, typename Integral, typename Function>
+    morton_result<Cube, typename Region::real_type>
+    integrate_morton(const Region& region, const Cube& cube, Integral Int, Function f, unsigned max_splits,
+                     bool return_cubes = false, TRAVERSAL order = BREADTH_FIRST) {
+        using real_type = typename Region::real_type;
+        using active_type = typename Region::active_type;
+        using code_type = morton_cube<Cube::dimensions>;
+        constexpr std::size_t parts = std::size_t(1) << Cube::dimensions;
+        if (max_splits > code_type::max_level)
+            throw std::invalid_argument("max_splits is more than the levels of Morton codes of this dimension");
+
+        auto result = morton_result<Cube, real_type>{};
+        result.origin = std::make_shared<Cube>(cube);
+
+        auto root = region.boundaries();
+        REGION_STATE root_state = region.contains(cube, root);
+        // Breadth-first takes the cubes from the front, depth-first from the back
+        std::deque<std::tuple<code_type, active_type, REGION_STATE>> cubes {{ code_type(), std::move(root), root_state }};
+
+        while (!cubes.empty()) {
+            auto [code, active, state] = std::move(order == DEPTH_FIRST ? cubes.back() : cubes.front());
+            if (order == DEPTH_FIRST)
+                cubes.pop_back();
+            else
+                cubes.pop_front();
+
+            const Cube hc = code.cube(cube);
+
+            switch (state) {
+                case INDEFINITE:
+                    if (code.level() >= max_splits) {
+                        const auto& [mlow, mhigh] = region.measure_estimates(hc, active);
+                        const auto& [flow, fhigh] = f(hc);
+                        const auto& [low, error] = boundary_estimates<real_type>(mlow, mhigh, flow, fhigh);
+                        result.sum += low;
+                        result.error += error;
+                    } else {
+                        std::array<REGION_STATE, parts> states;
+                        std::array<active_type, parts> actives;
+                        classify_parts(region, hc, active, states, actives);
+                        // Reversed for depth-first, so that the first part is visited first
+                        for (std::size_t k = 0; k < parts; k++) {
+                            const std::size_t i = order == DEPTH_FIRST ? parts - 1 - k : k;
+                            cubes.emplace_back(code.child(i), std::move(actives[i]), states[i]);
+                        }
+                        continue;
+                    }
+                    break;
+
+                case CONTAINED:
+                    add_integral(result, Int(hc));
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (return_cubes)
+                result.cubes.push_back({ code, state });
+        }
+
+        return result;
+    }
+}
+
+#endif // MORTON_H
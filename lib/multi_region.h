@@ -0,0 +1,134 @@
+#ifndef MULTI_REGION_H
+#define MULTI_REGION_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <queue>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "const.h"
+#include "integrationresult.h"
+#include "traversal.h"
+
+/* Integration of one function over many regions within the same bounding cube.
+ * The cube is split once for all of them: every cube keeps the state of each region
+ * that has not resolved it yet, Int and f are evaluated at most once per cube,
+ * and a cube is only split while some region is still undecided about it
+ */
+
+namespace Integration {
+    // Same as regions[k].integrate(cube, Int, f, max_splits, return_cubes) for every k,
+    // with identical sums and errors. The results share their cubes
+    template <typename Region, typename Cube, typename Integral, typename Function>
+    std::vector<Result<Cube, typename Region::real_type>>
+    integrate_regions(const std::vector<Region>& regions, const Cube& cube, Integral Int, Function f,
+                      unsigned max_splits, bool return_cubes = false) {
+        using real_type = typename Region::real_type;
+        using active_type = typename Region::active_type;
+        constexpr std::size_t parts = std::size_t(1) << Cube::dimensions;
+
+        // A region that still has to be resolved at a cube
+        struct region_entry {
+            std::size_t index;
+            active_type active;
+            REGION_STATE state;
+        };
+
+        struct cube_info {
+            Cube* hc;
+            unsigned int depth;
+            std::vector<region_entry> regions;
+        };
+
+        std::vector<Result<Cube, real_type>> results(regions.size());
+        auto origin = std::make_shared<Cube>(cube);
+        auto arena = std::make_shared<cube_arena<Cube>>();
+        for (auto& result : results) {
+            result.origin = origin;
+            result.arena = arena;
+        }
+
+        std::vector<region_entry> roots;
+        roots.reserve(regions.size());
+        for (std::size_t k = 0; k < regions.size(); k++) {
+            auto active = regions[k].boundaries();
+            REGION_STATE state = regions[k].contains(cube, active);
+            roots.push_back({ k, std::move(active), state });
+        }
+
+        std::queue<cube_info> cubes {{ { arena->make(cube), 0, std::move(roots) } }};
+
+        for ( ; !cubes.empty(); cubes.pop()) {
+            auto& [hc, depth, entries] = cubes.front();
+            // Int and f of the cube, evaluated the first time a region needs them
+            bool has_integral = false, has_bounds = false;
+            std::pair<real_type, real_type> integral{0, 0};
+            real_type flow = 0, fhigh = 0;
+            std::array<std::vector<region_entry>, parts> children;
+            bool split = false, kept = false;
+
+            for (auto& [index, active, state] : entries) {
+                auto& result = results[index];
+
+                switch (state) {
+                    case INDEFINITE:
+                        if (depth >= max_splits) {
+                            if (!has_bounds) {
+                                std::tie(flow, fhigh) = f(*hc);
+                                has_bounds = true;
+                            }
+                            const auto& [mlow, mhigh] = regions[index].measure_estimates(*hc, active);
+                            const auto& [low, error] = boundary_estimates<real_type>(mlow, mhigh, flow, fhigh);
+                            result.sum += low;
+                            result.error += error;
+                        } else {
+                            std::array<REGION_STATE, parts> states;
+                            std::array<active_type, parts> actives;
+                            classify_parts(regions[index], *hc, active, states, actives);
+                            for (std::size_t i = 0; i < parts; i++)
+                                children[i].push_back({ index, std::move(actives[i]), states[i] });
+                            split = true;
+                            continue;
+                        }
+                        break;
+
+                    case CONTAINED:
+                        if (!has_integral) {
+                            integral = integral_estimates<real_type>(Int(*hc));
+                            has_integral = true;
+                        }
+                        result.sum += integral.first;
+                        result.error += integral.second;
+                        break;
+
+                    default:
+                        break;
+                }
+
+                if (return_cubes) {
+                    result.cubes.push_back({ hc, state });
+                    kept = true;
+                }
+            }
+
+            // Parts rejected by all regions are only needed for return_cubes
+            for (std::size_t i = 0; split && i < parts; i++) {
+                const bool needed = return_cubes ||
+                    std::any_of(children[i].begin(), children[i].end(),
+                                [](const region_entry& entry) { return entry.state != REJECTED; });
+                if (needed)
+                    cubes.push({ arena->make(hc->part(i)), depth + 1, std::move(children[i]) });
+            }
+
+            if (!kept)
+                arena->release(hc);
+        }
+
+        return results;
+    }
+}
+
+#endif // MULTI_REGION_H
@@ -0,0 +1,217 @@
+#ifndef MULTIVARIATE_NORMAL_H
+#define MULTIVARIATE_NORMAL_H
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "dimensions.h"
+#include "ellipsoid.h"
+#include "normal_distribution.h"
+#include "polygon.h"
+#include "quadric.h"
+
+/* Normal distribution with a given mean and covariance. With the Cholesky factor L of the
+ * covariance, x = mean + L z where z has the standard normal distribution. A region of x is
+ * mapped to the region of z it corresponds to, and the probability is integrated there with
+ * pdf_integral and pdf_minmax. A half-space <e, x> + d <= 0 becomes <L^T e, z> + <e, mean> + d <= 0,
+ * a quadric x^T A x + <b, x> + c <= 0 becomes z^T L^T A L z + <L^T (2 A mean + b), z> + q(mean) <= 0,
+ * and an ellipsoid stays one if L^T A L is diagonal. Other ellipsoids are whitened as quadrics
+ */
+
+namespace Integration {
+    template <unsigned int N = dynamic_dimensions>
+    class basic_multivariate_normal {
+    public:
+        using vector_type = coefficients_t<long double, N>;
+        // Rows of a matrix
+        using matrix_type = coefficients_t<vector_type, N>;
+
+        // Throws std::invalid_argument if the covariance is not positive definite
+        basic_multivariate_normal(vector_type _mean, const matrix_type& covariance)
+                : mean(std::move(_mean)), cholesky(covariance) {
+            const std::size_t n = mean.size();
+            if (covariance.size() != n)
+                throw std::invalid_argument("The covariance has a different number of variables");
+
+            for (std::size_t j = 0; j < n; j++) {
+                if (cholesky[j].size() != n)
+                    throw std::invalid_argument("The covariance is not a square matrix");
+
+                long double diagonal = covariance[j][j];
+                for (std::size_t k = 0; k < j; k++)
+                    diagonal -= cholesky[j][k] * cholesky[j][k];
+                if (!(diagonal > 0))
+                    throw std::invalid_argument("The covariance is not positive definite");
+                cholesky[j][j] = std::sqrt(diagonal);
+
+                for (std::size_t i = j + 1; i < n; i++) {
+                    long double value = covariance[i][j];
+                    for (std::size_t k = 0; k < j; k++)
+                        value -= cholesky[i][k] * cholesky[j][k];
+                    cholesky[i][j] = value / cholesky[j][j];
+                }
+                for (std::size_t k = j + 1; k < n; k++)
+                    cholesky[j][k] = 0;
+            }
+        }
+
+        const vector_type& mean_vector() const { return mean; }
+        // The lower triangular L with L L^T = covariance
+        const matrix_type& cholesky_factor() const { return cholesky; }
+
+        // The polygon in the standard normal coordinates z
+        template <typename Precision, unsigned int M>
+        basic_polygon<Precision, M> whiten(const basic_polygon<Precision, M>& region) const {
+            using real_type = typename Precision::real_type;
+            auto equations = region.equations;
+            for (auto& [e, d] : equations) {
+                long double shift = d;
+                for (std::size_t i = 0; i < mean.size(); i++)
+                    shift += e[i] * mean[i];
+
+                // (L^T e)_j = sum of e_i L_ij over i >= j, e_j is not needed after that
+                for (std::size_t j = 0; j < mean.size(); j++) {
+                    long double value = 0;
+                    for (std::size_t i = j; i < mean.size(); i++)
+                        value += e[i] * cholesky[i][j];
+                    e[j] = real_type(value);
+                }
+                d = real_type(shift);
+            }
+            return basic_polygon<Precision, M>(std::move(equations));
+        }
+
+        // The ellipsoid in the standard normal coordinates z, if it is still axis-aligned there,
+        // e.g. if the covariance is diagonal
+        template <typename Precision, unsigned int M>
+        std::optional<basic_ellipsoid<Precision, M>> whiten(const basic_ellipsoid<Precision, M>& region) const {
+            using real_type = typename Precision::real_type;
+            const auto& a = region.coefficients();
+            const std::size_t n = mean.size();
+
+            // Coefficients: the diagonal of L^T A L, which must have no other entries
+            auto coeffs = a;
+            for (std::size_t j = 0; j < n; j++) {
+                for (std::size_t k = j; k < n; k++) {
+                    long double value = 0, magnitude = 0;
+                    for (std::size_t i = k; i < n; i++) {
+                        value += a[i] * cholesky[i][j] * cholesky[i][k];
+                        magnitude += std::fabs(a[i] * cholesky[i][j] * cholesky[i][k]);
+                    }
+                    if (k == j)
+                        coeffs[j] = real_type(value);
+                    else if (std::fabs(value) > 8 * n * std::numeric_limits<real_type>::epsilon() * magnitude)
+                        return std::nullopt;
+                }
+            }
+
+            // Center: L^-1 (c - mean), by forward substitution
+            auto center = region.center_point();
+            std::vector<long double> u(n);
+            for (std::size_t i = 0; i < n; i++) {
+                long double value = center[i] - mean[i];
+                for (std::size_t k = 0; k < i; k++)
+                    value -= cholesky[i][k] * u[k];
+                u[i] = value / cholesky[i][i];
+                center[i] = real_type(u[i]);
+            }
+
+            return basic_ellipsoid<Precision, M>(std::move(coeffs), std::move(center), region.bound());
+        }
+
+        // The quadric in the standard normal coordinates z
+        template <typename Precision, unsigned int M>
+        basic_quadric<Precision, M> whiten(const basic_quadric<Precision, M>& region) const {
+            using real_type = typename Precision::real_type;
+            const auto& A = region.matrix();
+            const auto& b = region.linear();
+            const std::size_t n = mean.size();
+
+            // A L, and 2 A mean + b, the gradient at the mean
+            std::vector<long double> AL(n * n), gradient(n);
+            long double constant = region.constant();
+            for (std::size_t i = 0; i < n; i++) {
+                long double row = 0;
+                for (std::size_t j = 0; j < n; j++) {
+                    row += A[i][j] * mean[j];
+                    for (std::size_t k = j; k < n; k++)
+                        AL[i * n + j] += A[i][k] * cholesky[k][j];
+                }
+                gradient[i] = 2 * row + b[i];
+                constant += (row + b[i]) * mean[i];
+            }
+
+            auto matrix = A;
+            auto linear = b;
+            for (std::size_t j = 0; j < n; j++) {
+                long double value = 0;
+                for (std::size_t i = j; i < n; i++)
+                    value += cholesky[i][j] * gradient[i];
+                linear[j] = real_type(value);
+                for (std::size_t k = 0; k < n; k++) {
+                    long double entry = 0;
+                    for (std::size_t i = j; i < n; i++)
+                        entry += cholesky[i][j] * AL[i * n + k];
+                    matrix[j][k] = real_type(entry);
+                }
+            }
+            return basic_quadric<Precision, M>(std::move(matrix), std::move(linear), real_type(constant));
+        }
+
+        // Probability of the standard normal distribution outside of [-radius, radius]^dimensions
+        static long double tail_mass(std::size_t dimensions, long double radius) {
+            return -std::expm1(dimensions * std::log1p(-std::erfc(radius / std::sqrt(2.0L))));
+        }
+
+        // Probability of the region, integrated over the cube [-radius, radius]^N in the
+        // standard normal coordinates with the given number of splits. The probability outside
+        // of the cube is added to the error, so [sum, sum + error] still contains it. The cubes
+        // of the result are in the standard normal coordinates
+        template <typename Cube, typename Precision, unsigned int M>
+        auto probability(const basic_polygon<Precision, M>& region, unsigned max_splits,
+                         long double radius = 8, bool return_cubes = false) const {
+            return integrate_whitened<Cube>(whiten(region), max_splits, radius, return_cubes);
+        }
+
+        template <typename Cube, typename Precision, unsigned int M>
+        auto probability(const basic_quadric<Precision, M>& region, unsigned max_splits,
+                         long double radius = 8, bool return_cubes = false) const {
+            return integrate_whitened<Cube>(whiten(region), max_splits, radius, return_cubes);
+        }
+
+        // Same for an ellipsoid. If it is not axis-aligned in the standard normal coordinates,
+        // it is integrated there as a quadric
+        template <typename Cube, typename Precision, unsigned int M>
+        auto probability(const basic_ellipsoid<Precision, M>& region, unsigned max_splits,
+                         long double radius = 8, bool return_cubes = false) const {
+            if (const auto whitened = whiten(region))
+                return integrate_whitened<Cube>(*whitened, max_splits, radius, return_cubes);
+            return integrate_whitened<Cube>(whiten(basic_quadric<Precision, M>(region)), max_splits, radius, return_cubes);
+        }
+
+    private:
+        vector_type mean;
+        matrix_type cholesky;
+
+        template <typename Cube, typename Region>
+        auto integrate_whitened(const Region& whitened, unsigned max_splits, long double radius,
+                                bool return_cubes) const {
+            using real_type = typename Region::real_type;
+            static_assert(dimensions_match<N, Cube>, "The distribution has a different number of variables");
+            auto result = whitened.integrate(Cube(-radius, radius), basic_pdf_integral<real_type>,
+                                             basic_pdf_minmax<real_type>, max_splits, return_cubes);
+            result.error += real_type(tail_mass(Cube::dimensions, radius));
+            return result;
+        }
+    };
+
+    using multivariate_normal = basic_multivariate_normal<>;
+    template <unsigned int N>
+    using fixed_multivariate_normal = basic_multivariate_normal<N>;
+}
+
+#endif // MULTIVARIATE_NORMAL_H
@@ -1,8 +1,16 @@
 #ifndef NORMAL_DISTRIBUTION_H
 #define NORMAL_DISTRIBUTION_H
 
+#include <array>
+#include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
 #include <utility>
+#include <vector>
+#include "const.h"
 
 /* Utilities for integrating normal PDF
 */
@@ -13,18 +21,20 @@ namespace Integration {
         return std::erfc(-x / std::sqrt(2)) / 2;
     }
 
-    // Integral of the normal PDF over the cube
-    const auto pdf_integral = [](const auto& hc) {
-        long double rv = 1;
+    // Integral of the normal PDF over the cube, in Real
+    template <typename Real>
+    const auto basic_pdf_integral = [](const auto& hc) {
+        Real rv = 1;
         for (const auto& [a, b] : hc.intervals)
             rv *= normal_cdf(b) - normal_cdf(a);
         return rv;
     };
 
-    // Minimum and maximum of the normal PDF at the cube
-    const auto pdf_minmax = [](const auto& hc) {
-        long double min = 0, max = 0;
-        constexpr long double common = std::pow(2 * pi(), hc.dimensions / -2.0);
+    // Minimum and maximum of the normal PDF at the cube, in Real
+    template <typename Real>
+    const auto basic_pdf_minmax = [](const auto& hc) {
+        Real min = 0, max = 0;
+        constexpr Real common = std::pow(2 * pi(), hc.dimensions / -2.0);
 
         for (const auto& [a, b]: hc.intervals) {
             if ((a + b) / 2 < 0)
@@ -44,6 +54,234 @@ namespace Integration {
         max = common * exp(max / -2);
         return std::make_pair(min, max);
     };
+
+    const auto pdf_integral = basic_pdf_integral<long double>;
+    const auto pdf_minmax = basic_pdf_minmax<long double>;
+
+    // Axes along which the normal PDF is symmetric about the center of the cube, i.e. those
+    // where the cube is centered at 0, as a mask for integrate_symmetric
+    template <typename Cube>
+    std::uint64_t pdf_symmetric_axes(const Cube& cube) {
+        std::uint64_t rv = 0;
+        for (std::size_t k = 0; k < Cube::dimensions; k++)
+            if (cube.intervals[k].first + cube.intervals[k].second == 0)
+                rv |= std::uint64_t(1) << k;
+        return rv;
+    }
+
+    // Normal CDF approximated by polynomials of the given degree on pieces of the given width
+    // over [-limit, limit], and 0 or 1 outside of it. The polynomials interpolate erfc, computed
+    // in long double, at the Chebyshev nodes of each piece, so their error is bounded by the
+    // derivatives of the normal PDF (Cramer's bound on Hermite polynomials). max_error adds the
+    // rounding of the coefficients and of the evaluation with some headroom
+    class normal_cdf_table {
+    public:
+        static constexpr unsigned int degree = 8;
+        static constexpr double limit = 9, width = 0.125;
+        static constexpr std::size_t pieces = 144;
+
+        normal_cdf_table() {
+            constexpr unsigned int nodes = degree + 1;
+            const long double half = width / 2;
+            long double magnitude = 0;
+
+            for (std::size_t piece = 0; piece < pieces; piece++) {
+                const long double center = -limit + (piece + 0.5L) * width;
+
+                // Chebyshev coefficients of the interpolant in t = (x - center) / half
+                std::array<long double, nodes> chebyshev{};
+                for (unsigned int m = 0; m < nodes; m++) {
+                    const long double angle = pi() * (m + 0.5L) / nodes;
+                    const long double value = std::erfc(-(center + half * std::cos(angle)) / std::sqrt(2.0L)) / 2;
+                    for (unsigned int j = 0; j < nodes; j++)
+                        chebyshev[j] += 2 * value * std::cos(j * angle) / nodes;
+                }
+                chebyshev[0] /= 2;
+
+                // To powers of t, with T_j(t) = 2t T_(j-1)(t) - T_(j-2)(t)
+                std::array<long double, nodes> power{}, previous{}, current{}, next{};
+                previous[0] = 1;
+                current[1] = 1;
+                for (unsigned int j = 0; j < nodes; j++) {
+                    const auto& T = j == 0 ? previous : current;
+                    for (unsigned int k = 0; k < nodes; k++)
+                        power[k] += chebyshev[j] * T[k];
+                    if (j > 0) {
+                        for (unsigned int k = 0; k < nodes; k++)
+                            next[k] = (k > 0 ? 2 * current[k - 1] : 0) - previous[k];
+                        previous = current;
+                        current = next;
+                    }
+                }
+
+                long double sum = 0;
+                for (unsigned int k = 0; k < nodes; k++) {
+                    coefficients[piece * nodes + k] = power[k];
+                    sum += std::fabs(power[k]);
+                }
+                magnitude = std::max(magnitude, sum);
+            }
+
+            // |PDF^(degree)| <= 1.086435 sqrt(degree!) / sqrt(2 pi), and Chebyshev interpolation
+            // errs by at most |f^(nodes)| half^nodes / (2^degree nodes!)
+            long double factorial = 1;
+            for (unsigned int k = 2; k <= degree; k++)
+                factorial *= k;
+            const long double interpolation = 1.086435L * std::sqrt(factorial) / std::sqrt(2 * pi()) *
+                                              std::pow(half, nodes) / (std::pow(2.0L, degree) * factorial * nodes);
+            const long double epsilon = std::numeric_limits<double>::epsilon();
+            const long double rounding = (2 * degree + 1) * epsilon * magnitude;
+            // erfc in long double and the tails beyond the limit
+            const long double reference = 1e-18L + std::erfc(limit / std::sqrt(2.0L)) / 2;
+            error = 2 * (interpolation + rounding + reference);
+        }
+
+        // The table shared by all callers, filled on first use
+        static const normal_cdf_table& instance() {
+            static const normal_cdf_table table;
+            return table;
+        }
+
+        // Bound of |cdf[k] - normal_cdf(x[k])| for the values of operator()
+        double max_error() const { return error; }
+
+        // cdf[k] = CDF(x[k]) for k < n. The pieces are picked by index, so the loop has no
+        // branches and vectorizes where the instruction set can gather the coefficients.
+        // x - center rounds where |x| is much smaller than the center, by less than an ulp
+        // of the width, which changes the CDF far less than the headroom of max_error.
+        // The polynomial is evaluated with Estrin's scheme, whose chains of dependent
+        // operations are half as long as those of Horner's, and whose rounding is bounded
+        // by the same
+        INTEGRATION_TARGET_CLONES
+        void operator()(const double* x, double* cdf, std::size_t n) const {
+            for (std::size_t k = 0; k < n; k++) {
+                const double y = std::min(std::max(x[k], -limit), limit);
+                const int piece = std::min(int((y + limit) * (1 / width)), int(pieces) - 1);
+                const double t = (y - (-limit + (piece + 0.5) * width)) * (2 / width);
+                const double* c = coefficients.data() + piece * (degree + 1);
+                const double t2 = t * t, t4 = t2 * t2;
+                const double p = (c[0] + c[1] * t) + t2 * (c[2] + c[3] * t) +
+                                 t4 * ((c[4] + c[5] * t) + t2 * (c[6] + c[7] * t) + t4 * c[8]);
+                cdf[k] = x[k] <= -limit ? 0 : x[k] >= limit ? 1 : p;
+            }
+        }
+
+    private:
+        static_assert(degree == 8, "operator() evaluates polynomials of degree 8");
+
+        // Of t^0 .. t^degree for each piece
+        std::array<double, pieces * (degree + 1)> coefficients;
+        double error;
+    };
+
+    // Integral of the normal PDF over the cube with normal_cdf_table, as a pair of the
+    // integral in Real and a bound of its error, which integrate adds to Result::error
+    // (see integral_estimates). The CDF at all 2N ends of the intervals is computed in one batch
+    template <typename Real>
+    const auto basic_bounded_pdf_integral = [](const auto& hc) {
+        using cube_type = std::decay_t<decltype(hc)>;
+        using coordinate_type = typename cube_type::interval_type::first_type;
+        constexpr std::size_t N = cube_type::dimensions;
+        const auto& table = normal_cdf_table::instance();
+
+        std::array<double, 2 * N> x, cdf;
+        for (std::size_t i = 0; i < N; i++) {
+            x[2 * i] = hc.intervals[i].first;
+            x[2 * i + 1] = hc.intervals[i].second;
+        }
+        table(x.data(), cdf.data(), x.size());
+
+        // Error of each difference of CDFs: of both ends, of rounding wider coordinates
+        // to double (the PDF is below 0.4) and of the subtraction
+        constexpr double epsilon = std::numeric_limits<double>::epsilon();
+        const double delta = 2 * table.max_error() + epsilon +
+                             (sizeof(coordinate_type) > sizeof(double) ? 0.8 * normal_cdf_table::limit * epsilon : 0);
+
+        // |prod d_i - prod d'_i| <= prod(|d'_i| + delta) - prod |d'_i| if |d_i - d'_i| <= delta
+        Real rv = 1, high = 1;
+        for (std::size_t i = 0; i < N; i++) {
+            const Real d = cdf[2 * i + 1] - cdf[2 * i];
+            rv *= d;
+            high *= std::fabs(d) + delta;
+        }
+        const Real error = high - std::fabs(rv) + (2 * N + 2) * std::numeric_limits<Real>::epsilon() * high;
+        return std::make_pair(rv, error);
+    };
+
+    const auto bounded_pdf_integral = basic_bounded_pdf_integral<long double>;
+
+    // Normal CDF at the grid of the cubes obtained by splitting root up to the given number
+    // of times. Cube endpoints are looked up in the grid instead of calling erfc, other
+    // values are computed directly. The tables are filled in the constructor, so one grid
+    // can be used from many threads
+    template <typename Cube, typename Real = long double>
+    class normal_grid {
+    public:
+        using coordinate_type = typename Cube::interval_type::first_type;
+
+        normal_grid(const Cube& root, unsigned int levels)
+                : cells(std::size_t(1) << levels) {
+            assert(levels < 8 * sizeof(std::size_t) - 1);
+            for (std::size_t i = 0; i < Cube::dimensions; i++) {
+                const auto& [a, b] = root.intervals[i];
+                origin[i] = a;
+                scale[i] = cells / (double(b) - double(a));
+
+                auto& points = grid[i];
+                points.resize(cells + 1);
+                points.front().x = a;
+                points.back().x = b;
+                // Midpoints in the order HyperCube::part computes them, so they compare equal
+                for (std::size_t step = cells; step > 1; step /= 2)
+                    for (std::size_t k = step / 2; k < cells; k += step)
+                        points[k].x = (points[k - step / 2].x + points[k + step / 2].x) / 2;
+                for (auto& point : points)
+                    point.cdf = normal_cdf(point.x);
+            }
+        }
+
+        // Same as basic_pdf_integral<Real>(hc)
+        Real integral(const Cube& hc) const {
+            Real rv = 1;
+            for (std::size_t i = 0; i < Cube::dimensions; i++) {
+                const auto& [a, b] = hc.intervals[i];
+                rv *= cdf(i, b) - cdf(i, a);
+            }
+            return rv;
+        }
+
+        // Same as basic_pdf_minmax<Real>(hc). Its two exps cost less than looking up
+        // a factor per dimension, so there is no table for them
+        std::pair<Real, Real> minmax(const Cube& hc) const {
+            return basic_pdf_minmax<Real>(hc);
+        }
+
+    private:
+        struct grid_point {
+            coordinate_type x;
+            double cdf;
+        };
+
+        std::size_t cells;
+        // Grid coordinate of x in dimension i is (x - origin[i]) * scale[i]
+        std::array<double, Cube::dimensions> origin, scale;
+        std::array<std::vector<grid_point>, Cube::dimensions> grid;
+
+        // The grid point of the i-th dimension at x, if x is one. The coordinate is only
+        // rounded to pick a candidate, which is then compared with x exactly
+        const grid_point* find(std::size_t i, coordinate_type x) const {
+            const double position = (double(x) - origin[i]) * scale[i] + 0.5;
+            if (!(position >= 0 && position < cells + 1))
+                return nullptr;
+            const auto& point = grid[i][std::size_t(position)];
+            return point.x == x ? &point : nullptr;
+        }
+
+        double cdf(std::size_t i, coordinate_type x) const {
+            const grid_point* point = find(i, x);
+            return point ? point->cdf : normal_cdf(x);
+        }
+    };
 }
 
 #endif // NORMAL_DISTRIBUTION_H
@@ -0,0 +1,179 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "const.h"
+#include "integrationresult.h"
+#include "traversal.h"
+
+/* Multi-threaded integration. The top of the tree is classified on the calling
+ * thread, the subtrees of the boundary cubes found there are integrated on a
+ * work-stealing pool and their results are added up in a fixed order,
+ * so that sum and error do not depend on the number of threads
+ */
+
+namespace Integration {
+    // Calls task(i) for every i in [0, count) on the given number of threads.
+    // Each thread starts with a contiguous block of indices, takes them from the back
+    // of its own deque, and steals from the front of the other deques once it runs out
+    template <typename Task>
+    void run_work_stealing(std::size_t count, unsigned int threads, Task task) {
+        struct task_queue {
+            std::mutex lock;
+            std::deque<std::size_t> indices;
+        };
+
+        threads = std::max(1u, std::min<unsigned int>(threads, count));
+        std::vector<task_queue> queues(threads);
+        for (std::size_t i = 0; i < count; i++)
+            queues[i * threads / count].indices.push_back(i);
+
+        std::mutex error_lock;
+        std::exception_ptr error;
+
+        auto worker = [&](unsigned int id) {
+            for (;;) {
+                std::size_t index = 0;
+                bool found = false;
+
+                for (unsigned int k = 0; !found && k < threads; k++) {
+                    auto& queue = queues[(id + k) % threads];
+                    std::lock_guard<std::mutex> guard(queue.lock);
+                    if (queue.indices.empty())
+                        continue;
+
+                    found = true;
+                    if (k == 0) {
+                        index = queue.indices.back();
+                        queue.indices.pop_back();
+                    } else {
+                        index = queue.indices.front();
+                        queue.indices.pop_front();
+                    }
+                }
+
+                // No new tasks appear while running, so all deques are drained
+                if (!found)
+                    return;
+
+                try {
+                    task(index);
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(error_lock);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned int id = 1; id < threads; id++)
+            pool.emplace_back(worker, id);
+        worker(0);
+        for (auto& t : pool)
+            t.join();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // Depth of the cubes whose subtrees become separate tasks: the smallest depth with
+    // at least 1024 cubes. It only depends on the dimension, and so do the results
+    constexpr unsigned int parallel_task_depth(unsigned int dimensions) {
+        return (10 + dimensions - 1) / dimensions;
+    }
+
+    // Sum of parts[first, last) added up pairwise, so the order of additions is fixed
+    template <typename Cube, typename Real>
+    std::pair<Real, Real> pairwise_sum(const std::vector<Result<Cube, Real>>& parts,
+                                       std::size_t first, std::size_t last) {
+        if (last - first == 0)
+            return {0, 0};
+        if (last - first == 1)
+            return {parts[first].sum, parts[first].error};
+
+        std::size_t middle = first + (last - first) / 2;
+        const auto& [lsum, lerror] = pairwise_sum(parts, first, middle);
+        const auto& [rsum, rerror] = pairwise_sum(parts, middle, last);
+        return {lsum + rsum, lerror + rerror};
+    }
+
+    // Same as region.integrate(cube, Int, f, max_splits, return_cubes), on the given number
+    // of threads (all hardware threads if 0). Int and f are called concurrently
+    template <typename Region, typename Cube, typename Integral, typename Function>
+    Result<Cube, typename Region::real_type> integrate_parallel(const Region& region, const Cube& cube,
+                                                                Integral Int, Function f, unsigned max_splits,
+                                                                unsigned int threads = 0, bool return_cubes = false) {
+        using active_type = typename Region::active_type;
+        using result_type = Result<Cube, typename Region::real_type>;
+        using cube_info = queued_cube<Region, Cube>;
+
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        auto result = result_type{};
+        result.origin = std::make_shared<Cube>(cube);
+        result.arena = std::make_shared<cube_arena<Cube>>();
+
+        // Boundary cubes at the task depth, to be split by the pool
+        std::vector<std::tuple<Cube*, unsigned int, active_type>> tasks;
+        auto root = region.boundaries();
+        REGION_STATE state = region.contains(cube, root);
+        std::queue<cube_info> top {{ { result.arena->make(cube), 0, std::move(root), state } }};
+        integrate_queue(region, result, top, Int, f, max_splits, return_cubes,
+                        parallel_task_depth(Cube::dimensions),
+                        [&](Cube* hc, unsigned int depth, active_type active) {
+                            tasks.emplace_back(hc, depth, std::move(active));
+                        });
+
+        std::vector<result_type> parts(tasks.size());
+        run_work_stealing(tasks.size(), threads, [&](std::size_t i) {
+            auto& [hc, depth, active] = tasks[i];
+            // Every task allocates its cubes separately, the arenas are merged afterwards if the
+            // cubes are returned
+            parts[i] = result_type{};
+            parts[i].arena = std::make_shared<cube_arena<Cube>>();
+
+            std::queue<cube_info> cubes;
+            split_classified(region, *parts[i].arena, *hc, active,
+                             [&, depth = depth](Cube* part, REGION_STATE state, active_type active) {
+                                 cubes.push({ part, depth + 1, std::move(active), state });
+                             });
+
+            integrate_queue(region, parts[i], cubes, Int, f, max_splits, return_cubes,
+                            UINT_MAX, [](auto&&...) { });
+            // Without return_cubes the arena only holds released cubes, so it is freed right away
+            if (!return_cubes)
+                parts[i].arena.reset();
+        });
+
+        const auto& [sum, error] = pairwise_sum(parts, 0, parts.size());
+        result.sum += sum;
+        result.error += error;
+
+        for (auto& [hc, depth, active] : tasks)
+            result.arena->release(hc);
+
+        if (return_cubes) {
+            for (auto& part : parts) {
+                result.cubes.insert(result.cubes.end(), part.cubes.begin(), part.cubes.end());
+                result.arena->merge(std::move(*part.arena));
+            }
+        }
+
+        return result;
+    }
+}
+
+#endif // PARALLEL_H
@@ -3,112 +3,193 @@
 
 #include <cstddef>
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <vector>
-#include <functional>
+#include <memory>
 #include <numeric>
 #include <utility>
-#include <queue>
 #include <tuple>
+#include <type_traits>
 #include "const.h"
+#include "dimensions.h"
 #include "linear.h"
+#include "precision.h"
+#include "region.h"
 
 /* Utilities for integrating over regions restricted by
  * equations of the form <e, x> + d <= 0 (linear), i.e. polygons
  */
 
 namespace Integration {
-    class polygon
+    template <typename Precision, unsigned int N = dynamic_dimensions>
+    class basic_polygon : public integrable_region<basic_polygon<Precision, N>>
     {
     public:
-        std::vector<linear_equation> equations;
+        using real_type = typename Precision::real_type;
+        using classify_type = typename Precision::classify_type;
+        using equation_type = basic_linear_equation<real_type, N>;
 
-        polygon(std::vector<linear_equation> _equations)
+        std::vector<equation_type> equations;
+
+        basic_polygon(std::vector<equation_type> _equations)
                 : equations(std::move(_equations)) { }
 
-        template <typename Cube, typename Integral, typename Function>
-        auto integrate(const Cube& cube, Integral Int, Function f,
-                       unsigned max_splits, bool return_cubes = false) const {
-            REGION_STATE state;
-            Result<Cube> result{};
-            unsigned int depth = 0;
-            auto hc = std::make_shared<Cube>(cube);
-            result.origin = hc;
+        // Constraints that a cube inherits from its parent, as indices into equations.
+        // The list is shared with the parent and only copied when some of them are dropped
+        using active_type = std::shared_ptr<const std::vector<std::size_t>>;
 
+        // Constraints of the bounding cube, i.e. all equations
+        active_type boundaries() const {
             std::vector<std::size_t> all_equations(equations.size());
             std::iota(all_equations.begin(), all_equations.end(), 0);
+            return std::make_shared<const std::vector<std::size_t>>(std::move(all_equations));
+        }
 
-            using cube_info = std::tuple<std::shared_ptr<Cube>, unsigned int, std::vector<std::size_t>>;
-            std::queue<cube_info> cubes {{ {hc, depth, std::move(all_equations)} }};
-
-            for ( ; !cubes.empty(); cubes.pop()) {
-                auto& triplet = cubes.front();
-                hc = std::get<0>(triplet);
-                depth = std::get<1>(triplet);
-                std::vector<std::size_t> boundaries = std::move(std::get<2>(triplet));
-
-                boundaries.erase(
-                    std::remove_if(boundaries.begin(), boundaries.end(),
-                        [&](const auto& i) {
-                            const auto& [e, d] = equations[i];
-                            return linear_max(*hc, e, d) <= 0;
-                        }
-                    ), boundaries.end());
-
-                if (boundaries.empty()) {
-                    state = CONTAINED;
-                } else {
-                    state = INDEFINITE;
-
-                    for (const auto& i : boundaries) {
-                        const auto& [e, d] = equations[i];
-                        if (linear_min(*hc, e, d) >= 0) {
-                            state = REJECTED;
-                            break;
-                        }
-                    }
+        // Drop the equations that hold everywhere in the cube from boundaries,
+        // and classify the cube against the remaining ones
+        template <typename Cube>
+        REGION_STATE contains(const Cube& hc, active_type& boundaries) const {
+            static_assert(dimensions_match<N, Cube>, "The equations have a different number of variables");
+            const auto& current = *boundaries;
+            std::vector<std::size_t> remaining;
+            bool dropped = false;
+
+            for (std::size_t k = 0; k < current.size(); k++) {
+                const auto& [e, d] = equations[current[k]];
+                if (linear_max(hc, e, d) <= 0) {
+                    if (!dropped)
+                        remaining.assign(current.begin(), current.begin() + k);
+                    dropped = true;
+                } else if (linear_min(hc, e, d) >= 0) {
+                    return REJECTED;
+                } else if (dropped) {
+                    remaining.push_back(current[k]);
                 }
+            }
+
+            if (dropped)
+                boundaries = std::make_shared<const std::vector<std::size_t>>(std::move(remaining));
 
-                switch (state) {
-                    case INDEFINITE:
-                        if (depth >= max_splits) {
-                            long double mlow, mhigh, flow, fhigh;
-                            if (boundaries.size() > 1) {
-                                mlow = 0;
-                                mhigh = hc->volume();
-                            } else {
-                                const auto& [e, d] = equations[boundaries[0]];
-                                mlow = mhigh = single_section_measure(*hc, e, d);
-                            }
-
-                            std::tie(flow, fhigh) = f(*hc);
-                            result.sum += std::min(0.0L,  flow) * mhigh + std::max(0.0L,  flow) * mlow;
-                            result.error += ((std::max(0.0L, fhigh) - std::min(0.0L,  flow)) * mhigh +
-                                             (std::min(0.0L, fhigh) - std::max(0.0L,  flow)) * mlow);
-                        } else {
-                            depth++;
-                            for (auto p : hc->split())
-                                cubes.push({ p, depth, boundaries });
-                            continue;
-                        }
-                        break;
-
-                    case CONTAINED:
-                        result.sum += Int(*hc);
-                        break;
-
-                    default:
-                        break;
+            return boundaries->empty() ? CONTAINED : INDEFINITE;
+        }
+
+        // States and constraints of all 2^N parts of hc, the same as contains(hc.part(i), ...)
+        // for each of them. Every equation is evaluated at all parts at once in classify_type,
+        // and only the parts where rounding could change the outcome are checked in real_type
+        template <typename Cube>
+        INTEGRATION_TARGET_CLONES
+        void contains_parts(const Cube& hc, const active_type& boundaries,
+                            std::array<REGION_STATE, std::size_t(1) << Cube::dimensions>& states,
+                            std::array<active_type, std::size_t(1) << Cube::dimensions>& actives) const {
+            static_assert(dimensions_match<N, Cube>, "The equations have a different number of variables");
+            constexpr unsigned int dimensions = Cube::dimensions;
+            constexpr std::size_t parts = parts_batch<dimensions, classify_type>::size;
+            const auto& current = *boundaries;
+            const parts_batch<dimensions, classify_type> batch(hc);
+            std::array<classify_type, dimensions> coeffs;
+            std::array<classify_type, parts> min, max;
+            std::array<std::vector<std::size_t>, parts> remaining;
+            std::array<bool, parts> dropped;
+            std::size_t rejected = 0;
+            states.fill(INDEFINITE);
+            dropped.fill(false);
+
+            for (std::size_t k = 0; k < current.size() && rejected < parts; k++) {
+                const auto& [e, d] = equations[current[k]];
+                std::copy(e.begin(), e.begin() + dimensions, coeffs.begin());
+                linear_minmax_batch(batch, coeffs, classify_type(d), min, max);
+                const classify_type error = linear_batch_error<real_type>(batch, coeffs, classify_type(d));
+
+                for (std::size_t i = 0; i < parts; i++) {
+                    if (states[i] == REJECTED)
+                        continue;
+
+                    bool holds, violated;
+                    if (max[i] + error <= 0) {
+                        holds = true;
+                        violated = false;
+                    } else if (max[i] - error > 0 && (min[i] - error >= 0 || min[i] + error < 0)) {
+                        holds = false;
+                        violated = min[i] - error >= 0;
+                    } else {
+                        const auto part = hc.part(i);
+                        holds = linear_max(part, e, d) <= 0;
+                        violated = !holds && linear_min(part, e, d) >= 0;
+                    }
+
+                    if (holds) {
+                        if (!dropped[i])
+                            remaining[i].assign(current.begin(), current.begin() + k);
+                        dropped[i] = true;
+                    } else if (violated) {
+                        states[i] = REJECTED;
+                        rejected++;
+                    } else if (dropped[i]) {
+                        remaining[i].push_back(current[k]);
+                    }
                 }
+            }
 
-                // Destroy the cube unless return_cubes is true
-                if (return_cubes)
-                    result.cubes.push_back({ hc, state });
+            for (std::size_t i = 0; i < parts; i++) {
+                actives[i] = dropped[i] ? std::make_shared<const std::vector<std::size_t>>(std::move(remaining[i]))
+                                        : boundaries;
+                if (states[i] != REJECTED && actives[i]->empty())
+                    states[i] = CONTAINED;
             }
+        }
+
+        // Low and high estimates of the measure of the region within a boundary cube
+        template <typename Cube>
+        std::pair<real_type, real_type> measure_estimates(const Cube& hc,
+                                                          const active_type& boundaries) const {
+            static_assert(dimensions_match<N, Cube>, "The equations have a different number of variables");
+            if (boundaries->size() > 1)
+                return {0, hc.template volume<real_type>()};
+
+            const auto& [e, d] = equations[boundaries->front()];
+            real_type measure = single_section_measure(hc, e, d);
+            return {measure, measure};
+        }
+
+        // Operations to classify a cube, one per equation and variable, for intersection
+        std::size_t classification_cost() const {
+            return equations.size() * (equations.empty() ? 0 : equations.front().first.size());
+        }
 
-            return result;
+        // Whether reflecting x_axis about center maps every equation to one of the equations,
+        // for integrate_symmetric
+        bool symmetric(std::size_t axis, real_type center) const {
+            return std::all_of(equations.begin(), equations.end(), [&](const equation_type& equation) {
+                equation_type image = equation;
+                image.first[axis] = -equation.first[axis];
+                image.second = equation.second + 2 * equation.first[axis] * center;
+                return std::find(equations.begin(), equations.end(), image) != equations.end();
+            });
+        }
+
+        // How much the active equations change along each dimension of the cube,
+        // the largest |e_i| * width_i of them, for integrate_kd
+        template <typename Cube>
+        std::array<real_type, Cube::dimensions> split_priorities(const Cube& hc,
+                                                                 const active_type& boundaries) const {
+            std::array<real_type, Cube::dimensions> rv{};
+            for (std::size_t k : *boundaries) {
+                const auto& e = equations[k].first;
+                for (std::size_t i = 0; i < Cube::dimensions; i++) {
+                    const auto& [a, b] = hc.intervals[i];
+                    rv[i] = std::max(rv[i], real_type(std::fabs(e[i]) * (b - a)));
+                }
+            }
+            return rv;
         }
 
     };
+
+    using polygon = basic_polygon<extended_precision>;
+    // Polygon in N variables, its equations are std::arrays
+    template <unsigned int N>
+    using fixed_polygon = basic_polygon<extended_precision, N>;
 }
 
 #endif // POLYGON_H
@@ -0,0 +1,132 @@
+#ifndef POLYNOMIAL_H
+#define POLYNOMIAL_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "dimensions.h"
+#include "power_product.h"
+
+/* Sums of power products c1 * x^p1 + c2 * x^p2 + ... For every cube the powers of the
+ * ends of its intervals are computed once, up to the largest exponent of each variable,
+ * and shared by all terms. Each power then costs one multiplication, as with Horner's
+ * scheme, which has no such sharing between sparse terms in many variables.
+ * Variables a term has no exponents for have the exponent 0
+ */
+
+namespace Integration {
+    // A term c * x1^a1 * ... * xN^aN of a polynomial
+    template <unsigned int N = dynamic_dimensions>
+    using basic_monomial = std::pair<long double, coefficients_t<unsigned int, N>>;
+
+    template <unsigned int N = dynamic_dimensions>
+    class basic_polynomial {
+    public:
+        std::vector<basic_monomial<N>> terms;
+
+        basic_polynomial(std::vector<basic_monomial<N>> _terms) : terms(std::move(_terms)) {
+            std::size_t dimensions = 0;
+            for (const auto& [coefficient, exponents] : terms)
+                dimensions = std::max<std::size_t>(dimensions, exponents.size());
+
+            // Powers 0 .. degree + 1 of both ends, the last one for the integral
+            degrees.assign(dimensions, 0);
+            offsets.assign(dimensions + 1, 0);
+            for (const auto& [coefficient, exponents] : terms)
+                for (std::size_t i = 0; i < exponents.size(); i++)
+                    degrees[i] = std::max(degrees[i], exponents[i]);
+            for (std::size_t i = 0; i < dimensions; i++)
+                offsets[i + 1] = offsets[i] + 2 * (degrees[i] + 2);
+        }
+
+        // Integral of the function over the cube
+        template <typename Real = long double, typename Cube>
+        Real integral(const Cube& hc) const {
+            static_assert(dimensions_match<N, Cube>, "The polynomial has a different number of variables");
+            return with_powers<Real>(hc, [&](const Real* powers) {
+                Real rv = 0;
+                for (const auto& [coefficient, exponents] : terms) {
+                    Real term = coefficient;
+                    for (std::size_t i = 0; i < Cube::dimensions; i++) {
+                        const unsigned int exponent = i < exponents.size() ? exponents[i] : 0;
+                        const Real* power = powers + offset(i) + 2 * (exponent + 1);
+                        term *= (power[1] - power[0]) / (exponent + 1);
+                    }
+                    rv += term;
+                }
+                return rv;
+            });
+        }
+
+        // Bounds of the function at the cube: the sum of the exact bounds of the terms,
+        // so the same as basic_power_product::minmax for a single term
+        template <typename Real = long double, typename Cube>
+        std::pair<Real, Real> minmax(const Cube& hc) const {
+            static_assert(dimensions_match<N, Cube>, "The polynomial has a different number of variables");
+            return with_powers<Real>(hc, [&](const Real* powers) {
+                std::pair<Real, Real> rv{0, 0};
+                for (const auto& [coefficient, exponents] : terms) {
+                    std::pair<Real, Real> term{coefficient, coefficient};
+                    for (std::size_t i = 0; i < exponents.size(); i++) {
+                        const Real* power = powers + offset(i) + 2 * exponents[i];
+                        const Real* ends = powers + offset(i) + 2;
+                        term = interval_product(term, power_range(ends[0], ends[1], power[0], power[1], exponents[i]));
+                    }
+                    rv.first += term.first;
+                    rv.second += term.second;
+                }
+                return rv;
+            });
+        }
+
+    private:
+        // Largest exponent of each variable, and where its powers start in the table,
+        // for the variables the terms have exponents for
+        std::vector<unsigned int> degrees;
+        std::vector<std::size_t> offsets;
+
+        // Where the powers of the i-th variable start, 4 values for each variable after those
+        std::size_t offset(std::size_t i) const {
+            return i < degrees.size() ? offsets[i] : offsets.back() + 4 * (i - degrees.size());
+        }
+
+        // Tables of up to this many powers are kept on the stack
+        static constexpr std::size_t inline_powers = 64;
+
+        // Calls evaluate with the table of a^k, b^k for each interval [a, b] of the cube,
+        // k = 0 .. degree + 1: a^k at offset(i) + 2k, b^k right after it
+        template <typename Real, typename Cube, typename Evaluate>
+        auto with_powers(const Cube& hc, Evaluate evaluate) const {
+            // No term may have more exponents than the cube has variables
+            assert(degrees.size() <= Cube::dimensions);
+            std::array<Real, inline_powers> stack;
+            std::vector<Real> heap;
+            Real* powers = stack.data();
+            if (offset(Cube::dimensions) > inline_powers) {
+                heap.resize(offset(Cube::dimensions));
+                powers = heap.data();
+            }
+
+            for (std::size_t i = 0; i < Cube::dimensions; i++) {
+                Real* power = powers + offset(i);
+                const Real a = hc.intervals[i].first, b = hc.intervals[i].second;
+                const unsigned int degree = i < degrees.size() ? degrees[i] : 0;
+                power[0] = power[1] = 1;
+                for (unsigned int k = 1; k <= degree + 1; k++) {
+                    power[2 * k] = power[2 * k - 2] * a;
+                    power[2 * k + 1] = power[2 * k - 1] * b;
+                }
+            }
+            return evaluate(static_cast<const Real*>(powers));
+        }
+    };
+
+    using polynomial = basic_polynomial<>;
+    template <unsigned int N>
+    using fixed_polynomial = basic_polynomial<N>;
+}
+
+#endif // POLYNOMIAL_H
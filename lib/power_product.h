@@ -6,60 +6,77 @@
 #include <utility>
 #include <cstddef>
 #include <cmath>
+#include "dimensions.h"
 
 namespace Integration {
+    // x^p by repeated squaring, 0^0 = 1
+    template <typename Real>
+    Real integer_power(Real x, unsigned int p) {
+        Real rv = 1;
+        for ( ; p > 0; p >>= 1, x *= x)
+            if (p & 1)
+                rv *= x;
+        return rv;
+    }
+
+    // Minimum and maximum of x^p for x in [a, b], given ap = a^p and bp = b^p
+    template <typename Real>
+    std::pair<Real, Real> power_range(Real a, Real b, Real ap, Real bp, unsigned int p) {
+        if (p % 2 == 1 || a >= 0)
+            return {ap, bp};
+        if (b <= 0)
+            return {bp, ap};
+        return {p == 0 ? 1 : 0, std::max(ap, bp)};
+    }
+
+    // Minimum and maximum of x * y for x in [x.first, x.second], y in [y.first, y.second]
+    template <typename Real>
+    std::pair<Real, Real> interval_product(const std::pair<Real, Real>& x, const std::pair<Real, Real>& y) {
+        const Real p1 = x.first * y.first, p2 = x.first * y.second,
+                   p3 = x.second * y.first, p4 = x.second * y.second;
+        return {std::min({p1, p2, p3, p4}), std::max({p1, p2, p3, p4})};
+    }
+
     // Represents a function of the form x1^a1 * x2^a2 ... xN^aN,
-    // i.e. a monomial/power product
-    struct power_product {
-        std::vector<unsigned int> exponents;
+    // i.e. a monomial/power product. N is fixed or dynamic_dimensions (see dimensions.h)
+    template <unsigned int N = dynamic_dimensions>
+    struct basic_power_product {
+        coefficients_t<unsigned int, N> exponents;
 
-        power_product(std::vector<unsigned int> _exponents)
-                      : exponents(std::move(_exponents)) { }
+        basic_power_product(coefficients_t<unsigned int, N> _exponents)
+                            : exponents(std::move(_exponents)) { }
 
         // Integral of the function over the cube
-        template <typename Cube>
-        long double integral(const Cube& hc) const {
-            long double rv = 1;
+        template <typename Real = long double, typename Cube>
+        Real integral(const Cube& hc) const {
+            static_assert(dimensions_match<N, Cube>, "The power product has a different number of variables");
+            Real rv = 1;
             for (std::size_t i = 0; i < hc.dimensions; i++) {
                 const auto& [a, b] = hc.intervals[i];
                 const unsigned int exponent = exponents[i] + 1;
-                rv *= (std::pow(b, exponent) - std::pow(a, exponent)) / exponent;
+                rv *= (integer_power<Real>(b, exponent) - integer_power<Real>(a, exponent)) / exponent;
             }
             return rv;
         }
 
-        // Minimum and maximum of the function at the cube
-        template <typename Cube>
-        std::pair<long double, long double> minmax(const Cube& hc) const {
-            std::vector<long double> values{1};
-            long double a, b, first, second;
-
+        // Minimum and maximum of the function at the cube. The variables are independent,
+        // so these are the bounds of the product of the ranges of the factors
+        template <typename Real = long double, typename Cube>
+        std::pair<Real, Real> minmax(const Cube& hc) const {
+            static_assert(dimensions_match<N, Cube>, "The power product has a different number of variables");
+            std::pair<Real, Real> rv{1, 1};
             for (std::size_t i = 0; i < exponents.size(); i++) {
-                std::vector<long double> temp;
-                temp.reserve(values.size() * 3);
-
-                std::tie(a, b) = hc.intervals[i];
-                // NOTE: Assumption that 0 ^ p = 0 for any p
-                first = (a == 0) ? 0 : std::pow(a, exponents[i]);
-                second = (b == 0) ? 0 : std::pow(b, exponents[i]);
-
-                for (const auto& v : values) {
-                    temp.push_back(v * first);
-                    temp.push_back(v * second);
-                    if (exponents[i] % 2 == 0 && a <= 0 && b >= 0) {
-                        // 0 ^ exponents[i]
-                        temp.push_back(0);
-                    }
-                }
-
-                values = std::move(temp);
+                const Real a = hc.intervals[i].first, b = hc.intervals[i].second;
+                const unsigned int p = exponents[i];
+                rv = interval_product(rv, power_range(a, b, integer_power(a, p), integer_power(b, p), p));
             }
-
-            const auto& [min, max] = std::minmax_element(values.begin(), values.end());
-            return {*min, *max};
-
+            return rv;
         }
     };
+
+    using power_product = basic_power_product<>;
+    template <unsigned int N>
+    using fixed_power_product = basic_power_product<N>;
 }
 
 #endif // POWER_PRODUCT_H
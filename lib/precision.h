@@ -0,0 +1,62 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+
+#include <cmath>
+
+namespace Integration {
+    // Floating-point types of an integration. real_type is used for the equations, measures,
+    // bounds of the function and the sums, classify_type for the batched classification
+    // of cubes (see parts_batch), whose uncertain outcomes are re-checked in real_type
+    template <typename Real, typename Classify = Real>
+    struct precision {
+        using real_type = Real;
+        using classify_type = Classify;
+    };
+
+    using extended_precision = precision<long double, double>;
+    using double_precision = precision<double>;
+    // Classification in float, twice as many cubes per vector
+    using fast_precision = precision<double, float>;
+
+    // Neumaier's compensated sum: the rounding error of every addition is accumulated
+    // separately and added back when the value is read
+    template <typename Real>
+    class compensated {
+    public:
+        compensated(Real value = 0) : sum(value), compensation(0) { }
+
+        compensated& operator+=(Real x) {
+            Real t = sum + x;
+            if (std::fabs(sum) >= std::fabs(x))
+                compensation += (sum - t) + x;
+            else
+                compensation += (x - t) + sum;
+            sum = t;
+            return *this;
+        }
+
+        compensated& operator-=(Real x) {
+            return *this += -x;
+        }
+
+        // Exact if x is a power of two
+        compensated& operator*=(Real x) {
+            sum *= x;
+            compensation *= x;
+            return *this;
+        }
+
+        Real value() const {
+            return sum + compensation;
+        }
+
+        operator Real() const {
+            return value();
+        }
+
+    private:
+        Real sum, compensation;
+    };
+}
+
+#endif // PRECISION_H
@@ -0,0 +1,223 @@
+#ifndef QUADRIC_H
+#define QUADRIC_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <tuple>
+#include <type_traits>
+#include "const.h"
+#include "dimensions.h"
+#include "ellipsoid.h"
+#include "linear.h"
+#include "precision.h"
+#include "region.h"
+
+/* Utilities for integrating over regions restricted by an equation
+ * of the form  x^T A x + <b, x> + c <= 0  with a symmetric matrix A,
+ * e.g. rotated ellipsoids, hyperboloids, cylinders and paraboloids.
+ * Within a cube with midpoint m and half-widths r, x = m + h and
+ *   q(x) = q(m) + <g, h> + sum A_ii h_i^2 + sum over i != j of A_ij h_i h_j,  g = 2 A m + b,
+ * where every term of the first sum together with g_i h_i is bounded exactly along its axis,
+ * and the cross terms by |A_ij| r_i r_j. Bounded separately, they give an interval that
+ * contains the range of q at the cube, and is that range only without cross terms
+*/
+
+namespace Integration {
+    template <typename Precision, unsigned int N = dynamic_dimensions>
+    class basic_quadric : public integrable_region<basic_quadric<Precision, N>>
+    {
+    public:
+        using real_type = typename Precision::real_type;
+        using vector_type = coefficients_t<real_type, N>;
+        // Rows of A
+        using matrix_type = coefficients_t<vector_type, N>;
+
+    private:
+        matrix_type A;
+        vector_type b;
+        real_type c;
+
+    public:
+        // A is made symmetric as (A + A^T) / 2, which defines the same function
+        basic_quadric(matrix_type _A, vector_type _b, real_type _c)
+                : A(std::move(_A)), b(std::move(_b)), c(_c) {
+            for (std::size_t i = 0; i < b.size(); i++)
+                for (std::size_t j = 0; j < i; j++)
+                    A[i][j] = A[j][i] = (A[i][j] + A[j][i]) / 2;
+        }
+
+        // The region (x - center)^T A (x - center) - d <= 0
+        static basic_quadric centered(matrix_type A, const vector_type& center, real_type d) {
+            vector_type b = center;
+            real_type c = -d;
+            for (std::size_t i = 0; i < center.size(); i++) {
+                real_type row = 0;
+                for (std::size_t j = 0; j < center.size(); j++)
+                    row += (A[i][j] + A[j][i]) / 2 * center[j];
+                b[i] = -2 * row;
+                c += row * center[i];
+            }
+            return basic_quadric(std::move(A), std::move(b), c);
+        }
+
+        // The same region as the axis-aligned ellipsoid
+        explicit basic_quadric(const basic_ellipsoid<Precision, N>& region)
+                : basic_quadric(centered(diagonal(region.coefficients()), region.center_point(), region.bound())) { }
+
+        const matrix_type& matrix() const { return A; }
+        const vector_type& linear() const { return b; }
+        real_type constant() const { return c; }
+
+        // The region is given by a single equation, so cubes carry no constraints
+        using active_type = std::tuple<>;
+
+        active_type boundaries() const { return {}; }
+
+        // Conservative lower and upper bounds of the function at the cube (see above).
+        // They are its minimum and maximum only for a diagonal A
+        template <typename Cube>
+        std::pair<real_type, real_type> bounds(const Cube& hc) const {
+            static_assert(dimensions_match<N, Cube>, "The quadric has a different number of variables");
+            const auto& [value, g, r] = expansion(hc);
+            real_type min = value - cross_terms(r), max = value + cross_terms(r);
+
+            for (std::size_t i = 0; i < Cube::dimensions; i++) {
+                // g_i h + A_ii h^2 over [-r_i, r_i]: at the ends, and at the vertex if within
+                const real_type left = A[i][i] * r[i] * r[i] - g[i] * r[i],
+                                right = A[i][i] * r[i] * r[i] + g[i] * r[i];
+                real_type low = std::min(left, right), high = std::max(left, right);
+                if (A[i][i] != 0 && std::fabs(g[i]) <= 2 * std::fabs(A[i][i]) * r[i]) {
+                    const real_type vertex = -g[i] * g[i] / (4 * A[i][i]);
+                    low = std::min(low, vertex);
+                    high = std::max(high, vertex);
+                }
+                min += low;
+                max += high;
+            }
+            return {min, max};
+        }
+
+        template <typename Cube>
+        REGION_STATE contains(const Cube& hc) const {
+            const auto& [min, max] = bounds(hc);
+            if (max <= 0)
+                return CONTAINED;
+            if (min >= 0)
+                return REJECTED;
+            return INDEFINITE;
+        }
+
+        // The region lies between the half-spaces of the tangent plane at the midpoint,
+        // shifted by the bounds of the quadratic terms. These are taken per axis, with the
+        // half-width of that axis, so only the curvature along the sides of the cube counts
+        template <typename Cube>
+        std::pair<real_type, real_type> measure_estimates(const Cube& hc) const {
+            static_assert(dimensions_match<N, Cube>, "The quadric has a different number of variables");
+            const auto& [value, g, r] = expansion(hc);
+            real_type d = value, low = -cross_terms(r), high = cross_terms(r);
+            for (std::size_t i = 0; i < Cube::dimensions; i++) {
+                const auto& [a, b] = hc.intervals[i];
+                d -= g[i] * (a + b) / 2;
+                const real_type curvature = A[i][i] * r[i] * r[i];
+                low += std::min<real_type>(0, curvature);
+                high += std::max<real_type>(0, curvature);
+            }
+
+            return {single_section_measure(hc, g, d + high),
+                    single_section_measure(hc, g, d + low)};
+        }
+
+        template <typename Cube>
+        std::pair<real_type, real_type> measure_estimates(const Cube& hc, const active_type&) const {
+            return measure_estimates(hc);
+        }
+
+        template <typename Cube>
+        REGION_STATE contains(const Cube& hc, active_type&) const {
+            return contains(hc);
+        }
+
+        // Operations per variable to classify a cube, for intersection
+        std::size_t classification_cost() const { return b.size() * (b.size() + 2); }
+
+        // Whether reflecting x_axis about center does not change the function, i.e. x_axis has no
+        // cross terms and the vertex of its parabola is at center, for integrate_symmetric
+        bool symmetric(std::size_t axis, real_type center) const {
+            for (std::size_t j = 0; j < b.size(); j++)
+                if (j != axis && A[axis][j] != 0)
+                    return false;
+            return b[axis] + 2 * A[axis][axis] * center == 0;
+        }
+
+        // How much the function changes along each dimension of the cube, the largest
+        // derivative along it times the width, for integrate_kd
+        template <typename Cube>
+        std::array<real_type, Cube::dimensions> split_priorities(const Cube& hc, const active_type&) const {
+            const auto& [value, g, r] = expansion(hc);
+            std::array<real_type, Cube::dimensions> rv;
+            for (std::size_t i = 0; i < Cube::dimensions; i++) {
+                real_type derivative = std::fabs(g[i]);
+                for (std::size_t j = 0; j < Cube::dimensions; j++)
+                    derivative += 2 * std::fabs(A[i][j]) * r[j];
+                rv[i] = derivative * 2 * r[i];
+            }
+            return rv;
+        }
+
+    private:
+        static matrix_type diagonal(const vector_type& coeffs) {
+            matrix_type rv{};
+            if constexpr (N == dynamic_dimensions)
+                rv.assign(coeffs.size(), vector_type(coeffs.size(), 0));
+            for (std::size_t i = 0; i < coeffs.size(); i++) {
+                if constexpr (N != dynamic_dimensions)
+                    rv[i].fill(0);
+                rv[i][i] = coeffs[i];
+            }
+            return rv;
+        }
+
+        // q(m), the gradient g at the midpoint m and the half-widths r of the cube
+        template <typename Cube>
+        auto expansion(const Cube& hc) const {
+            constexpr std::size_t dimensions = Cube::dimensions;
+            std::array<real_type, dimensions> m, g, r;
+            for (std::size_t i = 0; i < dimensions; i++) {
+                const auto& [a, b] = hc.intervals[i];
+                m[i] = (real_type(a) + b) / 2;
+                r[i] = (real_type(b) - a) / 2;
+            }
+
+            real_type value = c;
+            for (std::size_t i = 0; i < dimensions; i++) {
+                real_type row = 0;
+                for (std::size_t j = 0; j < dimensions; j++)
+                    row += A[i][j] * m[j];
+                g[i] = 2 * row + b[i];
+                value += (row + b[i]) * m[i];
+            }
+            return std::make_tuple(value, g, r);
+        }
+
+        // Bound of |sum over i != j of A_ij h_i h_j| for |h_i| <= r_i
+        template <std::size_t dimensions>
+        real_type cross_terms(const std::array<real_type, dimensions>& r) const {
+            real_type rv = 0;
+            for (std::size_t i = 0; i < dimensions; i++)
+                for (std::size_t j = i + 1; j < dimensions; j++)
+                    rv += 2 * std::fabs(A[i][j]) * r[i] * r[j];
+            return rv;
+        }
+    };
+
+    using quadric = basic_quadric<extended_precision>;
+    // Quadric in N variables, its coefficients are std::arrays
+    template <unsigned int N>
+    using fixed_quadric = basic_quadric<extended_precision, N>;
+}
+
+#endif // QUADRIC_H
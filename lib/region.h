@@ -0,0 +1,111 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include <cstdint>
+#include <type_traits>
+#include "adaptive.h"
+#include "compiled_region.h"
+#include "const.h"
+#include "integrationresult.h"
+#include "kd.h"
+#include "morton.h"
+#include "parallel.h"
+#include "resumable.h"
+#include "sinks.h"
+#include "symmetry.h"
+#include "traversal.h"
+
+/* The integrations every region provides. A region implements the protocol described
+ * in adaptive.h and derives from integrable_region<Region>, which runs the shared
+ * traversals on it
+ */
+
+namespace Integration {
+    template <typename Region>
+    class integrable_region {
+    public:
+        // Integration over the cubes obtained by splitting cube up to max_splits times,
+        // breadth-first (see integrate_breadth_first) or depth-first (see integrate_depth_first)
+        template <typename Cube, typename Integral, typename Function>
+        auto integrate(const Cube& cube, Integral Int, Function f,
+                       unsigned max_splits, bool return_cubes = false,
+                       TRAVERSAL order = BREADTH_FIRST) const {
+            if (order == DEPTH_FIRST)
+                return integrate_depth_first(region(), cube, Int, f, max_splits, return_cubes);
+            return integrate_breadth_first(region(), cube, Int, f, max_splits, return_cubes);
+        }
+
+        // Same as integrate with max_splits, passing every cube to sink instead of keeping it
+        // (see sinks.h)
+        template <typename Cube, typename Integral, typename Function, typename Sink, typename R = Region,
+                  typename = std::enable_if_t<is_cube_sink<Sink, Cube, typename R::real_type>>>
+        auto integrate(const Cube& cube, Integral Int, Function f, unsigned max_splits,
+                       Sink& sink, TRAVERSAL order = BREADTH_FIRST) const {
+            return integrate_to_sink(region(), cube, Int, f, max_splits, sink, order);
+        }
+
+        // Same as integrate with max_splits, integrating only one of the halves along every axis
+        // of integrand_axes the region is symmetric along (see symmetry.h)
+        template <typename Cube, typename Integral, typename Function>
+        auto integrate_symmetric(const Cube& cube, Integral Int, Function f, unsigned max_splits,
+                                 std::uint64_t integrand_axes, bool return_cubes = false) const {
+            return Integration::integrate_symmetric(region(), cube, Int, f, max_splits, integrand_axes, return_cubes);
+        }
+
+        // Split the boundary cubes with the largest error first, until tol is met
+        template <typename Cube, typename Integral, typename Function>
+        auto integrate(const Cube& cube, Integral Int, Function f,
+                       const tolerance& tol, bool return_cubes = false) const {
+            return integrate_adaptive(region(), cube, Int, f, tol, return_cubes);
+        }
+
+        // integrate with max_splits for every (Int, f) pair of integrands in a single traversal
+        // (see integrate_many in traversal.h)
+        template <typename Cube, typename Integrands>
+        auto integrate_many(const Cube& cube, const Integrands& integrands,
+                            unsigned max_splits, bool return_cubes = false) const {
+            return Integration::integrate_many(region(), cube, integrands, max_splits, return_cubes);
+        }
+
+        // Same as integrate with max_splits, keeping the cubes as their codes (see morton.h)
+        template <typename Cube, typename Integral, typename Function>
+        auto integrate_morton(const Cube& cube, Integral Int, Function f, unsigned max_splits,
+                              bool return_cubes = false, TRAVERSAL order = BREADTH_FIRST) const {
+            return Integration::integrate_morton(region(), cube, Int, f, max_splits, return_cubes, order);
+        }
+
+        // Same as integrate with max_splits, bisecting one dimension at a time (see kd.h)
+        template <typename Cube, typename Integral, typename Function>
+        auto integrate_kd(const Cube& cube, Integral Int, Function f, unsigned max_splits,
+                          bool return_cubes = false) const {
+            return Integration::integrate_kd(region(), cube, Int, f, max_splits, return_cubes);
+        }
+
+        // Same as integrate with max_splits, but the boundary cubes can be refined further
+        // later on (see resumable.h)
+        template <typename Cube, typename Integral, typename Function>
+        auto integrate_resumable(const Cube& cube, Integral Int, Function f, unsigned max_splits,
+                                 bool return_cubes = false) const {
+            return resumable_integration(region(), cube, Int, f, max_splits, return_cubes);
+        }
+
+        // The cubes integrate with max_splits ends with, to be integrated many times
+        // (see compiled_region.h)
+        template <typename Cube, typename R = Region>
+        auto compile(const Cube& cube, unsigned max_splits, bool keep_rejected = true) const {
+            return compiled_region<Cube, typename R::real_type>(region(), cube, max_splits, keep_rejected);
+        }
+
+        // Same as integrate with max_splits, on the given number of threads (see parallel.h)
+        template <typename Cube, typename Integral, typename Function>
+        auto integrate_parallel(const Cube& cube, Integral Int, Function f, unsigned max_splits,
+                                unsigned int threads = 0, bool return_cubes = false) const {
+            return Integration::integrate_parallel(region(), cube, Int, f, max_splits, threads, return_cubes);
+        }
+
+    private:
+        const Region& region() const { return static_cast<const Region&>(*this); }
+    };
+}
+
+#endif // REGION_H
@@ -0,0 +1,118 @@
+#ifndef RESUMABLE_H
+#define RESUMABLE_H
+
+#include <memory>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "const.h"
+#include "integrationresult.h"
+#include "precision.h"
+#include "traversal.h"
+
+/* Integration that can be continued: the boundary cubes at the current depth are kept
+ * with their constraints, and refining only splits those further instead of starting
+ * again from the bounding cube
+ */
+
+namespace Integration {
+    template <typename Region, typename Cube, typename Integral, typename Function>
+    class resumable_integration {
+    public:
+        using real_type = typename Region::real_type;
+        using active_type = typename Region::active_type;
+
+        // Same as region.integrate(cube, Int, f, max_splits, return_cubes) so far
+        resumable_integration(Region region, const Cube& cube, Integral Int, Function f,
+                              unsigned max_splits, bool return_cubes = false)
+                : region(std::move(region)), Int(std::move(Int)), f(std::move(f)),
+                  return_cubes(return_cubes) {
+            settled.origin = std::make_shared<Cube>(cube);
+            settled.arena = std::make_shared<cube_arena<Cube>>();
+
+            auto root = this->region.boundaries();
+            REGION_STATE state = this->region.contains(cube, root);
+            std::queue<queued_cube<Region, Cube>> cubes {{ { settled.arena->make(cube), 0, std::move(root), state } }};
+            advance(cubes, max_splits);
+        }
+
+        // Depth of the boundary cubes
+        unsigned int depth() const { return current_depth; }
+
+        real_type sum() const { return total_sum; }
+        real_type error() const { return total_error; }
+
+        // Split the boundary cubes extra_levels more times, as if integrate had been called
+        // with max_splits = depth() + extra_levels. The contained cubes found so far stay
+        void refine(unsigned int extra_levels = 1) {
+            std::queue<queued_cube<Region, Cube>> cubes;
+            for (auto& [hc, active, low, error] : frontier)
+                cubes.push({ hc, current_depth, std::move(active), INDEFINITE });
+            frontier.clear();
+            advance(cubes, current_depth + extra_levels);
+        }
+
+        // Refine one level at a time until the error is at most target,
+        // or the boundary cubes are at depth max_splits
+        void refine_until(real_type target, unsigned max_splits) {
+            while (total_error > target && current_depth < max_splits && !frontier.empty())
+                refine();
+        }
+
+        // The integration so far, as returned by integrate. The cubes are only valid
+        // until the next refine, which splits the boundary ones
+        Result<Cube, real_type> result() const {
+            auto result = Result<Cube, real_type>{};
+            result.sum = total_sum;
+            result.error = total_error;
+            result.origin = settled.origin;
+            result.arena = settled.arena;
+            if (return_cubes) {
+                result.cubes = settled.cubes;
+                for (const auto& boundary : frontier)
+                    result.cubes.push_back({ boundary.hc, INDEFINITE });
+            }
+            return result;
+        }
+
+    private:
+        // A boundary cube at the current depth and its contribution
+        struct frontier_cube {
+            Cube* hc;
+            active_type active;
+            real_type low, error;
+        };
+
+        Region region;
+        Integral Int;
+        Function f;
+        bool return_cubes;
+        // The contained (and, with return_cubes, the rejected) cubes
+        Result<Cube, real_type> settled;
+        std::vector<frontier_cube> frontier;
+        unsigned int current_depth = 0;
+        compensated<real_type> total_sum, total_error;
+
+        // Integrate the cubes down to max_splits, keeping the boundary cubes found there.
+        // The totals are added up anew, so no old contribution is subtracted
+        void advance(std::queue<queued_cube<Region, Cube>>& cubes, unsigned int max_splits) {
+            integrate_queue(region, settled, cubes, Int, f, max_splits + 1, return_cubes, max_splits,
+                            [&](Cube* hc, unsigned int, active_type active) {
+                                const auto& [mlow, mhigh] = region.measure_estimates(*hc, active);
+                                const auto& [flow, fhigh] = f(*hc);
+                                const auto& [low, error] = boundary_estimates<real_type>(mlow, mhigh, flow, fhigh);
+                                frontier.push_back({ hc, std::move(active), low, error });
+                            });
+            current_depth = max_splits;
+
+            total_sum = settled.sum;
+            total_error = settled.error;
+            for (const auto& boundary : frontier) {
+                total_sum += boundary.low;
+                total_error += boundary.error;
+            }
+        }
+    };
+}
+
+#endif // RESUMABLE_H
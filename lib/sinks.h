@@ -0,0 +1,161 @@
+#ifndef SINKS_H
+#define SINKS_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "const.h"
+#include "integrationresult.h"
+#include "storage.h"
+#include "traversal.h"
+
+/* Streaming the cubes of an integration instead of keeping them in Result::cubes.
+ * A sink is called as sink(hc, state, depth, contribution) with every cube the tree
+ * ends with, where contribution is the (sum, error) the cube adds to the result.
+ * Sinks that also take measure are called as sink(hc, state, depth, contribution, measure)
+ * with the bounds of the measure of the region within the cube. The cube is only valid
+ * during the call. binary_file_sink is in storage.h
+ */
+
+namespace Integration {
+    template <typename Sink, typename Cube, typename Real>
+    constexpr bool is_measure_sink = std::is_invocable_v<Sink&, const Cube&, REGION_STATE, unsigned int,
+                                                         const std::pair<Real, Real>&, const std::pair<Real, Real>&>;
+
+    template <typename Sink, typename Cube, typename Real>
+    constexpr bool is_cube_sink = is_measure_sink<Sink, Cube, Real> ||
+                                  std::is_invocable_v<Sink&, const Cube&, REGION_STATE, unsigned int,
+                                                      const std::pair<Real, Real>&>;
+
+    // Same as region.integrate(cube, Int, f, max_splits, false, order), calling sink with
+    // every cube instead of returning them. Each cube is released right after the call
+    template <typename Region, typename Cube, typename Integral, typename Function, typename Sink>
+    Result<Cube, typename Region::real_type> integrate_to_sink(const Region& region, const Cube& cube,
+                                                               Integral Int, Function f, unsigned max_splits,
+                                                               Sink& sink, TRAVERSAL order = BREADTH_FIRST) {
+        using real_type = typename Region::real_type;
+        constexpr std::size_t parts = std::size_t(1) << Cube::dimensions;
+
+        auto result = Result<Cube, real_type>{};
+        result.origin = std::make_shared<Cube>(cube);
+        result.arena = std::make_shared<cube_arena<Cube>>();
+        auto& arena = *result.arena;
+
+        auto root = region.boundaries();
+        REGION_STATE root_state = region.contains(cube, root);
+        // Breadth-first takes the cubes from the front, depth-first from the back
+        std::deque<queued_cube<Region, Cube>> cubes {{ arena.make(cube), 0, std::move(root), root_state }};
+
+        while (!cubes.empty()) {
+            auto [hc, depth, active, state] = std::move(order == DEPTH_FIRST ? cubes.back() : cubes.front());
+            if (order == DEPTH_FIRST)
+                cubes.pop_back();
+            else
+                cubes.pop_front();
+
+            std::pair<real_type, real_type> contribution{0, 0}, measure{0, 0};
+
+            switch (state) {
+                case INDEFINITE:
+                    if (depth >= max_splits) {
+                        measure = region.measure_estimates(*hc, active);
+                        const auto& [flow, fhigh] = f(*hc);
+                        contribution = boundary_estimates<real_type>(measure.first, measure.second, flow, fhigh);
+                    } else {
+                        split_classified(region, arena, *hc, active,
+                                         [&, depth = depth](Cube* part, REGION_STATE state, auto active) {
+                                             cubes.emplace_back(part, depth + 1, std::move(active), state);
+                                         });
+                        // Reversed for depth-first, so that the first part is visited first
+                        if (order == DEPTH_FIRST)
+                            std::reverse(cubes.end() - parts, cubes.end());
+                        arena.release(hc);
+                        continue;
+                    }
+                    break;
+
+                case CONTAINED:
+                    contribution = integral_estimates<real_type>(Int(*hc));
+                    measure.first = measure.second = hc->template volume<real_type>();
+                    break;
+
+                default:
+                    break;
+            }
+
+            result.sum += contribution.first;
+            result.error += contribution.second;
+            if constexpr (is_measure_sink<Sink, Cube, real_type>)
+                sink(*hc, state, depth, contribution, measure);
+            else
+                sink(*hc, state, depth, contribution);
+            arena.release(hc);
+        }
+
+        return result;
+    }
+
+    // Counts the cubes of each state
+    struct counting_sink {
+        std::array<std::size_t, 3> counts{};
+
+        template <typename Cube, typename Contribution>
+        void operator()(const Cube&, REGION_STATE state, unsigned int, const Contribution&) {
+            counts[state]++;
+        }
+
+        std::size_t total() const {
+            return counts[REJECTED] + counts[CONTAINED] + counts[INDEFINITE];
+        }
+    };
+
+    // A cube as seen by a sink
+    template <typename Cube, typename Real = long double>
+    struct sunk_cube {
+        Cube hc;
+        REGION_STATE state;
+        unsigned int depth;
+        std::pair<Real, Real> contribution;
+    };
+
+    // Uniform sample of at most capacity cubes out of all of them (reservoir sampling)
+    template <typename Cube, typename Real = long double>
+    class reservoir_sink {
+    public:
+        explicit reservoir_sink(std::size_t capacity, std::uint64_t seed = 0)
+                : capacity(capacity), random(seed) {
+            cubes.reserve(capacity);
+        }
+
+        void operator()(const Cube& hc, REGION_STATE state, unsigned int depth,
+                        const std::pair<Real, Real>& contribution) {
+            seen++;
+            if (cubes.size() < capacity) {
+                cubes.push_back({ hc, state, depth, contribution });
+            } else {
+                std::uniform_int_distribution<std::size_t> index(0, seen - 1);
+                std::size_t i = index(random);
+                if (i < capacity)
+                    cubes[i] = { hc, state, depth, contribution };
+            }
+        }
+
+        const std::vector<sunk_cube<Cube, Real>>& sample() const { return cubes; }
+        // Number of cubes the sample was taken from
+        std::size_t count() const { return seen; }
+
+    private:
+        std::size_t capacity, seen = 0;
+        std::mt19937_64 random;
+        std::vector<sunk_cube<Cube, Real>> cubes;
+    };
+}
+
+#endif // SINKS_H
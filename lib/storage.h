@@ -0,0 +1,318 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "const.h"
+#include "integrationresult.h"
+#include "precision.h"
+
+/* Binary files of the cubes of an integration, written by binary_file_sink and read
+ * in place with mapped_decomposition. A file consists of
+ *  - decomposition_header: format, dimension, scalar types, number of records;
+ *  - decomposition_totals: the origin cube, the sum and the error;
+ *  - cube_record[records], starting at records_offset;
+ *  - optionally, the depth index at index_offset: index_depths + 1 record numbers,
+ *    where the records of depth d are [index[d], index[d + 1]). It is only written if
+ *    the records come in order of depth, i.e. from a breadth-first traversal
+ * All numbers are in the byte order of the machine that wrote the file
+ */
+
+namespace Integration {
+    // Scalar type codes of the header
+    template <typename T>
+    constexpr std::uint8_t scalar_kind = std::is_same_v<T, float> ? 1 :
+                                         std::is_same_v<T, double> ? 2 :
+                                         std::is_same_v<T, long double> ? 3 : 0;
+
+    struct decomposition_header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t dimensions;
+        std::uint8_t coordinate_kind, coordinate_size, real_kind, real_size;
+        std::uint32_t record_size;
+        std::uint64_t records;
+        std::uint64_t records_offset;
+        std::uint64_t index_offset;
+        std::uint32_t index_depths;
+        // Zeros, up to 64 bytes, so that the totals after the header are aligned
+        std::uint32_t reserved[3];
+
+        static constexpr char format[8] = { 'N', 'I', 'D', 'E', 'C', 'O', 'M', 'P' };
+        // Version 1 had a 56-byte header, which misaligned totals of long double
+        static constexpr std::uint32_t current_version = 2;
+    };
+
+    static_assert(sizeof(decomposition_header) == 64, "The header has a fixed size");
+
+    template <typename Cube, typename Real>
+    struct decomposition_totals {
+        Cube origin;
+        Real sum, error;
+    };
+
+    // A cube with its contribution (sum, error) to the result and the bounds of the measure
+    // of the region within it (the volume for contained cubes, 0 for rejected ones)
+    template <typename Cube, typename Real>
+    struct cube_record {
+        Cube hc;
+        Real sum, error, mlow, mhigh;
+        std::uint32_t depth;
+        REGION_STATE state;
+    };
+
+    // Records start at a multiple of this
+    constexpr std::size_t record_alignment = 64;
+
+    constexpr std::size_t align_up(std::size_t size, std::size_t alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    // The totals follow the header, aligned for reading them in place
+    template <typename Cube, typename Real>
+    constexpr std::size_t totals_offset() {
+        constexpr std::size_t offset = align_up(sizeof(decomposition_header), alignof(decomposition_totals<Cube, Real>));
+        static_assert(offset == sizeof(decomposition_header), "The header is padded to align the totals");
+        return offset;
+    }
+
+    template <typename Cube, typename Real>
+    constexpr std::size_t records_offset() {
+        return align_up(totals_offset<Cube, Real>() + sizeof(decomposition_totals<Cube, Real>), record_alignment);
+    }
+
+    // Header of a file of cube_record<Cube, Real>, without the records and the index
+    template <typename Cube, typename Real>
+    decomposition_header make_decomposition_header() {
+        using coordinate_type = typename Cube::interval_type::first_type;
+        decomposition_header header;
+        std::memset(static_cast<void*>(&header), 0, sizeof(header));
+        std::memcpy(header.magic, decomposition_header::format, sizeof(header.magic));
+        header.version = decomposition_header::current_version;
+        header.dimensions = Cube::dimensions;
+        header.coordinate_kind = scalar_kind<coordinate_type>;
+        header.coordinate_size = sizeof(coordinate_type);
+        header.real_kind = scalar_kind<Real>;
+        header.real_size = sizeof(Real);
+        header.record_size = sizeof(cube_record<Cube, Real>);
+        header.records_offset = records_offset<Cube, Real>();
+        return header;
+    }
+
+    // Writes the cubes it is called with to a file, see integrate_to_sink.
+    // The header is completed by close(), or when the sink is destroyed
+    template <typename Cube, typename Real = long double>
+    class binary_file_sink {
+    public:
+        using record_type = cube_record<Cube, Real>;
+
+        binary_file_sink(const std::string& path, const Cube& origin)
+                : out(path, std::ios::binary | std::ios::trunc), totals{ origin, 0, 0 } {
+            const auto header = make_decomposition_header<Cube, Real>();
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            write_totals();
+            const std::size_t padding = header.records_offset - totals_offset<Cube, Real>() -
+                                        sizeof(decomposition_totals<Cube, Real>);
+            out.write(std::string(padding, '\0').data(), padding);
+        }
+
+        binary_file_sink(const binary_file_sink&) = delete;
+        binary_file_sink& operator=(const binary_file_sink&) = delete;
+
+        ~binary_file_sink() {
+            close();
+        }
+
+        void operator()(const Cube& hc, REGION_STATE state, unsigned int depth,
+                        const std::pair<Real, Real>& contribution, const std::pair<Real, Real>& measure) {
+            // Zeroed first, so that the padding of the record is written as zeros
+            record_type record;
+            std::memset(static_cast<void*>(&record), 0, sizeof(record));
+            record.hc = hc;
+            std::tie(record.sum, record.error) = contribution;
+            std::tie(record.mlow, record.mhigh) = measure;
+            record.depth = depth;
+            record.state = state;
+            out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+
+            totals.sum += contribution.first;
+            totals.error += contribution.second;
+            sorted = sorted && depth >= (index.empty() ? 0 : index.size() - 1);
+            while (index.size() <= depth)
+                index.push_back(count);
+            count++;
+        }
+
+        void close() {
+            if (!out.is_open())
+                return;
+
+            auto header = make_decomposition_header<Cube, Real>();
+            header.records = count;
+            if (sorted && count > 0) {
+                index.push_back(count);
+                header.index_offset = header.records_offset + count * sizeof(record_type);
+                header.index_depths = index.size() - 1;
+                out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(std::uint64_t));
+            }
+
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            write_totals();
+            out.close();
+        }
+
+        bool good() const { return out.good(); }
+
+    private:
+        std::ofstream out;
+        decomposition_totals<Cube, compensated<Real>> totals;
+        std::uint64_t count = 0;
+        // index[d] is the number of records before the first one of depth d
+        std::vector<std::uint64_t> index;
+        bool sorted = true;
+
+        // At totals_offset, after the header and its padding
+        void write_totals() {
+            const std::size_t padding = totals_offset<Cube, Real>() - sizeof(decomposition_header);
+            out.seekp(sizeof(decomposition_header));
+            out.write(std::string(padding, '\0').data(), padding);
+            decomposition_totals<Cube, Real> plain;
+            std::memset(static_cast<void*>(&plain), 0, sizeof(plain));
+            plain.origin = totals.origin;
+            plain.sum = totals.sum;
+            plain.error = totals.error;
+            out.write(reinterpret_cast<const char*>(&plain), sizeof(plain));
+        }
+    };
+
+    // A file written by binary_file_sink, mapped into memory. The records are read in place,
+    // so opening even a large file costs next to nothing. Throws std::runtime_error if the
+    // file cannot be read or was written for another Cube or Real
+    template <typename Cube, typename Real = long double>
+    class mapped_decomposition {
+    public:
+        using record_type = cube_record<Cube, Real>;
+
+        explicit mapped_decomposition(const std::string& path) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Cannot open " + path);
+
+            struct stat info;
+            if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+                size = info.st_size;
+                data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            ::close(fd);
+            if (data == nullptr || data == MAP_FAILED) {
+                data = nullptr;
+                throw std::runtime_error("Cannot map " + path);
+            }
+
+            const auto expected = make_decomposition_header<Cube, Real>();
+            if (size < totals_offset<Cube, Real>() + sizeof(decomposition_totals<Cube, Real>) ||
+                    std::memcmp(header().magic, expected.magic, sizeof(expected.magic)) != 0 ||
+                    header().version != expected.version || header().dimensions != expected.dimensions ||
+                    header().coordinate_kind != expected.coordinate_kind ||
+                    header().coordinate_size != expected.coordinate_size ||
+                    header().real_kind != expected.real_kind || header().real_size != expected.real_size ||
+                    header().record_size != expected.record_size ||
+                    header().records_offset + header().records * sizeof(record_type) > size ||
+                    (header().index_offset != 0 &&
+                     header().index_offset + (header().index_depths + 1) * sizeof(std::uint64_t) > size)) {
+                ::munmap(data, size);
+                data = nullptr;
+                throw std::runtime_error(path + " is not a decomposition of this type");
+            }
+        }
+
+        mapped_decomposition(const mapped_decomposition&) = delete;
+        mapped_decomposition& operator=(const mapped_decomposition&) = delete;
+
+        ~mapped_decomposition() {
+            if (data != nullptr)
+                ::munmap(data, size);
+        }
+
+        const decomposition_header& header() const {
+            return *static_cast<const decomposition_header*>(data);
+        }
+
+        const Cube& origin() const { return totals().origin; }
+        Real sum() const { return totals().sum; }
+        Real error() const { return totals().error; }
+
+        std::size_t records() const { return header().records; }
+        const record_type* begin() const { return reinterpret_cast<const record_type*>(bytes() + header().records_offset); }
+        const record_type* end() const { return begin() + records(); }
+        const record_type& operator[](std::size_t i) const { return begin()[i]; }
+
+        bool has_depth_index() const { return header().index_offset != 0; }
+
+        // Records of the given depth, if the file has a depth index
+        std::pair<const record_type*, const record_type*> depth(unsigned int d) const {
+            if (!has_depth_index() || d >= header().index_depths)
+                return { end(), end() };
+            const auto* index = reinterpret_cast<const std::uint64_t*>(bytes() + header().index_offset);
+            return { begin() + index[d], begin() + index[d + 1] };
+        }
+
+        // Integral of another function over the stored cubes. If the file was written by a
+        // breadth-first integrate_to_sink, this is the same as integrating it over the region
+        template <typename Integral, typename Function>
+        Result<Cube, Real> integrate(Integral Int, Function f) const {
+            auto result = Result<Cube, Real>{};
+            result.origin = std::make_shared<Cube>(origin());
+            for (const auto& record : *this) {
+                if (record.state == CONTAINED) {
+                    add_integral(result, Int(record.hc));
+                } else if (record.state == INDEFINITE) {
+                    const auto& [flow, fhigh] = f(record.hc);
+                    const auto& [low, error] = boundary_estimates<Real>(record.mlow, record.mhigh, flow, fhigh);
+                    result.sum += low;
+                    result.error += error;
+                }
+            }
+            return result;
+        }
+
+        // The stored integration as a Result with its cubes, e.g. for view_result
+        Result<Cube, Real> result() const {
+            auto result = Result<Cube, Real>{};
+            result.sum = sum();
+            result.error = error();
+            result.origin = std::make_shared<Cube>(origin());
+            result.arena = std::make_shared<cube_arena<Cube>>();
+            result.cubes.reserve(records());
+            for (const auto& record : *this)
+                result.cubes.push_back({ result.arena->make(record.hc), record.state });
+            return result;
+        }
+
+    private:
+        void* data = nullptr;
+        std::size_t size = 0;
+
+        const char* bytes() const { return static_cast<const char*>(data); }
+
+        const decomposition_totals<Cube, Real>& totals() const {
+            return *reinterpret_cast<const decomposition_totals<Cube, Real>*>(bytes() + totals_offset<Cube, Real>());
+        }
+    };
+}
+
+#endif // STORAGE_H
@@ -0,0 +1,99 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include <bitset>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include "const.h"
+#include "integrationresult.h"
+#include "traversal.h"
+
+/* Integration over a fundamental domain of reflection symmetries. If the region and the
+ * integrand are both unchanged by reflecting x_k about the center of the bounding cube,
+ * the two halves of the cube along x_k have the same integral, so only one of them has
+ * to be integrated. The region tells whether it is symmetric with its member
+ * symmetric(k, center), the integrand cannot be inspected and is described by the caller
+ * as a mask of axes, e.g. pdf_symmetric_axes(cube) for pdf_integral
+ */
+
+namespace Integration {
+    // Mask of all axes, for integrands that are symmetric along all of them
+    constexpr std::uint64_t all_axes = ~std::uint64_t(0);
+
+    template <typename Region, typename = void>
+    struct has_symmetric : std::false_type { };
+
+    template <typename Region>
+    struct has_symmetric<Region, std::void_t<decltype(
+        std::declval<const Region&>().symmetric(std::size_t(0), typename Region::real_type(0)))>>
+        : std::true_type { };
+
+    // Axes of integrand_axes along which the region is symmetric about the center of the cube,
+    // as a mask with bit k for the k-th axis. None for regions without symmetric()
+    template <typename Region, typename Cube>
+    std::uint64_t symmetric_axes(const Region& region, const Cube& cube, std::uint64_t integrand_axes) {
+        static_assert(Cube::dimensions <= 64, "Axes are masks of 64 bits");
+        std::uint64_t rv = 0;
+        if constexpr (has_symmetric<Region>::value) {
+            for (std::size_t k = 0; k < Cube::dimensions; k++) {
+                const auto& [a, b] = cube.intervals[k];
+                if (integrand_axes >> k & 1 && region.symmetric(k, (a + b) / 2))
+                    rv |= std::uint64_t(1) << k;
+            }
+        }
+        return rv;
+    }
+
+    // Same as integrate_breadth_first(region, cube, Int, f, max_splits, return_cubes), with Int
+    // and f symmetric along integrand_axes. Of the 2^N parts of the cube, only those in the upper
+    // half along every axis of symmetric_axes(region, cube, integrand_axes) are integrated, with
+    // the same cubes as integrate, and sum and error are multiplied by 2 per axis. The result only
+    // differs by rounding, and its cubes only cover those parts
+    template <typename Region, typename Cube, typename Integral, typename Function>
+    Result<Cube, typename Region::real_type> integrate_symmetric(const Region& region, const Cube& cube,
+                                                                 Integral Int, Function f, unsigned max_splits,
+                                                                 std::uint64_t integrand_axes,
+                                                                 bool return_cubes = false) {
+        using real_type = typename Region::real_type;
+        constexpr std::size_t N = Cube::dimensions;
+
+        const std::uint64_t axes = symmetric_axes(region, cube, integrand_axes);
+        auto root = region.boundaries();
+        if (axes == 0 || max_splits == 0 || region.contains(cube, root) != INDEFINITE)
+            return integrate_breadth_first(region, cube, Int, f, max_splits, return_cubes);
+
+        auto result = Result<Cube, real_type>{};
+        result.origin = std::make_shared<Cube>(cube);
+        result.arena = std::make_shared<cube_arena<Cube>>();
+
+        // Bit N - 1 - k of the index of a part selects the half of the k-th interval
+        std::size_t upper = 0;
+        for (std::size_t k = 0; k < N; k++)
+            if (axes >> k & 1)
+                upper |= std::size_t(1) << (N - 1 - k);
+
+        std::queue<queued_cube<Region, Cube>> cubes;
+        for (std::size_t i = 0; i < (std::size_t(1) << N); i++) {
+            if ((i & upper) != upper)
+                continue;
+            Cube* part = result.arena->make(cube.part(i));
+            auto active = root;
+            REGION_STATE state = region.contains(*part, active);
+            cubes.push({ part, 1, std::move(active), state });
+        }
+        integrate_queue(region, result, cubes, Int, f, max_splits, return_cubes, max_splits,
+                        [](Cube*, unsigned int, auto) { });
+
+        const real_type scale = std::ldexp(real_type(1), int(std::bitset<64>(axes).count()));
+        result.sum *= scale;
+        result.error *= scale;
+        return result;
+    }
+}
+
+#endif // SYMMETRY_H
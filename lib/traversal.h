@@ -0,0 +1,271 @@
+#ifndef TRAVERSAL_H
+#define TRAVERSAL_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <queue>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "const.h"
+#include "integrationresult.h"
+
+/* Traversals of the tree of cubes shared by the regions. See adaptive.h
+ * for what a region has to provide
+ */
+
+namespace Integration {
+    // A cube waiting in a traversal: the cube, its depth, constraints and state
+    template <typename Region, typename Cube>
+    using queued_cube = std::tuple<Cube*, unsigned int, typename Region::active_type, REGION_STATE>;
+
+    template <typename Region, typename Cube, typename = void>
+    struct has_contains_parts : std::false_type { };
+
+    template <typename Region, typename Cube>
+    struct has_contains_parts<Region, Cube, std::void_t<decltype(
+        std::declval<const Region&>().contains_parts(
+            std::declval<const Cube&>(), std::declval<const typename Region::active_type&>(),
+            std::declval<std::array<REGION_STATE, std::size_t(1) << Cube::dimensions>&>(),
+            std::declval<std::array<typename Region::active_type, std::size_t(1) << Cube::dimensions>&>()))>>
+        : std::true_type { };
+
+    // States and constraints of all 2^N parts of hc (in the order of HyperCube::part).
+    // The parts are classified in one batch if the region provides contains_parts
+    template <typename Region, typename Cube>
+    void classify_parts(const Region& region, const Cube& hc, const typename Region::active_type& active,
+                        std::array<REGION_STATE, std::size_t(1) << Cube::dimensions>& states,
+                        std::array<typename Region::active_type, std::size_t(1) << Cube::dimensions>& actives) {
+        if constexpr (has_contains_parts<Region, Cube>::value) {
+            region.contains_parts(hc, active, states, actives);
+        } else {
+            for (std::size_t i = 0; i < states.size(); i++) {
+                actives[i] = active;
+                states[i] = region.contains(hc.part(i), actives[i]);
+            }
+        }
+    }
+
+    // Split hc into the arena and call visit(part, state, active) for every part, in order
+    template <typename Region, typename Cube, typename Visit>
+    void split_classified(const Region& region, cube_arena<Cube>& arena, const Cube& hc,
+                          const typename Region::active_type& active, Visit visit) {
+        constexpr std::size_t parts = std::size_t(1) << Cube::dimensions;
+        std::array<REGION_STATE, parts> states;
+        std::array<typename Region::active_type, parts> actives;
+        classify_parts(region, hc, active, states, actives);
+        for (std::size_t i = 0; i < parts; i++)
+            visit(arena.make(hc.part(i)), states[i], std::move(actives[i]));
+    }
+
+    // Adds the contribution of a contained cube, or of a boundary cube with [mlow, mhigh] bounds
+    // of the measure of the region within it, to the result of every (Int, f) pair of integrands
+    template <typename Cube, typename Real, std::size_t K, typename Integrands>
+    void add_contributions(std::array<Result<Cube, Real>, K>& results, const Integrands& integrands,
+                           const Cube& hc, REGION_STATE state, Real mlow = 0, Real mhigh = 0) {
+        std::apply([&](const auto&... integrand) {
+            std::size_t k = 0;
+            auto add = [&](auto& result, const auto& Int, const auto& f) {
+                if (state == CONTAINED) {
+                    add_integral(result, Int(hc));
+                } else {
+                    const auto& [flow, fhigh] = f(hc);
+                    const auto& [low, error] = boundary_estimates<Real>(mlow, mhigh, flow, fhigh);
+                    result.sum += low;
+                    result.error += error;
+                }
+            };
+            (add(results[k++], std::get<0>(integrand), std::get<1>(integrand)), ...);
+        }, integrands);
+    }
+
+    // Breadth-first integration of the (classified) cubes in the queue and their subtrees
+    // into result. INDEFINITE cubes at depth handoff_depth are passed to handoff instead of being split
+    template <typename Region, typename Cube, typename Integral, typename Function, typename Handoff>
+    void integrate_queue(const Region& region, Result<Cube, typename Region::real_type>& result,
+                         std::queue<queued_cube<Region, Cube>>& cubes,
+                         Integral& Int, Function& f, unsigned max_splits, bool return_cubes,
+                         unsigned int handoff_depth, Handoff handoff) {
+        for ( ; !cubes.empty(); cubes.pop()) {
+            auto& [hc, depth, active, state] = cubes.front();
+
+            switch (state) {
+                case INDEFINITE:
+                    if (depth >= max_splits) {
+                        const auto& [mlow, mhigh] = region.measure_estimates(*hc, active);
+                        const auto& [flow, fhigh] = f(*hc);
+                        const auto& [low, error] =
+                            boundary_estimates<typename Region::real_type>(mlow, mhigh, flow, fhigh);
+                        result.sum += low;
+                        result.error += error;
+                    } else if (depth == handoff_depth) {
+                        handoff(hc, depth, std::move(active));
+                        continue;
+                    } else {
+                        split_classified(region, *result.arena, *hc, active,
+                                         [&, depth = depth](Cube* part, REGION_STATE state, auto active) {
+                                             cubes.push({ part, depth + 1, std::move(active), state });
+                                         });
+                        result.arena->release(hc);
+                        continue;
+                    }
+                    break;
+
+                case CONTAINED:
+                    add_integral(result, Int(*hc));
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (return_cubes)
+                result.cubes.push_back({ hc, state });
+            else
+                result.arena->release(hc);
+        }
+    }
+
+    // Integration over the cubes obtained by splitting cube up to max_splits times, level by level.
+    // Cubes are classified when their parent is split, all siblings at once
+    template <typename Region, typename Cube, typename Integral, typename Function>
+    Result<Cube, typename Region::real_type> integrate_breadth_first(const Region& region, const Cube& cube,
+                                                                     Integral Int, Function f, unsigned max_splits,
+                                                                     bool return_cubes = false) {
+        auto result = Result<Cube, typename Region::real_type>{};
+        result.origin = std::make_shared<Cube>(cube);
+        result.arena = std::make_shared<cube_arena<Cube>>();
+
+        auto root = region.boundaries();
+        REGION_STATE state = region.contains(cube, root);
+        std::queue<queued_cube<Region, Cube>> cubes {{ { result.arena->make(cube), 0, std::move(root), state } }};
+        // Cubes at max_splits are summed before they could be handed off
+        integrate_queue(region, result, cubes, Int, f, max_splits, return_cubes, max_splits,
+                        [](Cube*, unsigned int, typename Region::active_type) { });
+        return result;
+    }
+
+    // Same as region.integrate(cube, Int, f, max_splits, return_cubes), but the tree is
+    // walked depth-first. Only the siblings of the cubes on the current path are kept,
+    // at most max_splits * (2^N - 1) + 1 cubes, instead of a whole level of the tree.
+    // The cubes are returned in preorder, and sum and error only differ by rounding
+    template <typename Region, typename Cube, typename Integral, typename Function>
+    Result<Cube, typename Region::real_type> integrate_depth_first(const Region& region, const Cube& cube,
+                                                                   Integral Int, Function f, unsigned max_splits,
+                                                                   bool return_cubes = false) {
+        using real_type = typename Region::real_type;
+        constexpr std::size_t parts = std::size_t(1) << Cube::dimensions;
+
+        auto result = Result<Cube, real_type>{};
+        result.origin = std::make_shared<Cube>(cube);
+        result.arena = std::make_shared<cube_arena<Cube>>();
+        auto& arena = *result.arena;
+
+        auto root = region.boundaries();
+        REGION_STATE root_state = region.contains(cube, root);
+        std::vector<queued_cube<Region, Cube>> cubes {{ arena.make(cube), 0, std::move(root), root_state }};
+        cubes.reserve(max_splits * (parts - 1) + 1);
+
+        while (!cubes.empty()) {
+            auto [hc, depth, active, state] = std::move(cubes.back());
+            cubes.pop_back();
+
+            switch (state) {
+                case INDEFINITE:
+                    if (depth >= max_splits) {
+                        const auto& [mlow, mhigh] = region.measure_estimates(*hc, active);
+                        const auto& [flow, fhigh] = f(*hc);
+                        const auto& [low, error] = boundary_estimates<real_type>(mlow, mhigh, flow, fhigh);
+                        result.sum += low;
+                        result.error += error;
+                    } else {
+                        split_classified(region, arena, *hc, active,
+                                         [&, depth = depth](Cube* part, REGION_STATE state, auto active) {
+                                             cubes.emplace_back(part, depth + 1, std::move(active), state);
+                                         });
+                        // Reversed, so that the first part is visited first
+                        std::reverse(cubes.end() - parts, cubes.end());
+                        arena.release(hc);
+                        continue;
+                    }
+                    break;
+
+                case CONTAINED:
+                    add_integral(result, Int(*hc));
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (return_cubes)
+                result.cubes.push_back({ hc, state });
+            else
+                arena.release(hc);
+        }
+
+        return result;
+    }
+
+    // Same as region.integrate(cube, Int, f, max_splits, return_cubes) for every (Int, f) pair
+    // of integrands, a std::tuple or std::array of them, in a single traversal. All functions
+    // are evaluated at a cube one after another, and the results share the same cubes
+    template <typename Region, typename Cube, typename Integrands>
+    auto integrate_many(const Region& region, const Cube& cube, const Integrands& integrands,
+                        unsigned max_splits, bool return_cubes = false) {
+        std::array<Result<Cube, typename Region::real_type>, std::tuple_size_v<Integrands>> results{};
+        auto origin = std::make_shared<Cube>(cube);
+        auto arena = std::make_shared<cube_arena<Cube>>();
+        std::vector<std::pair<const Cube*, REGION_STATE>> cubes_out;
+        for (auto& result : results) {
+            result.origin = origin;
+            result.arena = arena;
+        }
+
+        auto root = region.boundaries();
+        REGION_STATE root_state = region.contains(cube, root);
+        std::queue<queued_cube<Region, Cube>> cubes {{ { arena->make(cube), 0, std::move(root), root_state } }};
+
+        for ( ; !cubes.empty(); cubes.pop()) {
+            auto& [hc, depth, active, state] = cubes.front();
+
+            switch (state) {
+                case INDEFINITE:
+                    if (depth >= max_splits) {
+                        const auto& [mlow, mhigh] = region.measure_estimates(*hc, active);
+                        add_contributions(results, integrands, *hc, state, mlow, mhigh);
+                    } else {
+                        split_classified(region, *arena, *hc, active,
+                                         [&, depth = depth](Cube* part, REGION_STATE state, auto active) {
+                                             cubes.push({ part, depth + 1, std::move(active), state });
+                                         });
+                        arena->release(hc);
+                        continue;
+                    }
+                    break;
+
+                case CONTAINED:
+                    add_contributions(results, integrands, *hc, state);
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (return_cubes)
+                cubes_out.push_back({ hc, state });
+            else
+                arena->release(hc);
+        }
+
+        for (auto& result : results)
+            result.cubes = cubes_out;
+
+        return results;
+    }
+}
+
+#endif // TRAVERSAL_H
@@ -1,5 +1,5 @@
 TEMPLATE = app
-CONFIG += console c++1z -Wall
+CONFIG += console c++1z thread -Wall
 CONFIG -= app_bundle
 QT += widgets
 